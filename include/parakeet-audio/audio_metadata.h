@@ -8,7 +8,16 @@
 namespace parakeet_audio {
 
 /**
- * @brief Get the ID3 header size.
+ * @brief Parse a 28-bit ID3v2 sync safe integer (7 bits per byte, big endian).
+ * @private
+ *
+ * @param ptr 4 bytes.
+ * @return int32_t 0 if any byte has its top bit set.
+ */
+int32_t ParseID3SyncSafeInt(const uint8_t* ptr);
+
+/**
+ * @brief Get the ID3 header size, including the ID3v2.4 footer when present.
  * @private
  *
  * @param buffer
@@ -38,4 +47,25 @@ std::size_t GetAPEv2FullSize(const uint8_t* buffer, size_t buffer_len);
  */
 std::size_t GetAudioHeaderMetadataSize(const uint8_t* buffer, size_t buffer_len);
 
+/**
+ * @brief Get the FLAC stream header size: "fLaC" and all metadata blocks (STREAMINFO, PICTURE...),
+ *        i.e. the offset of the first frame.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return std::size_t 0 if `buffer` does not start with a complete FLAC stream header.
+ */
+std::size_t GetFLACMetadataSize(const uint8_t* buffer, size_t buffer_len);
+
+/**
+ * @brief Detect ID3v1/APEv2 Tags at the end of `buf`.
+ *        Only the last 160 bytes are read, so the end of a file is enough; the size returned
+ *        can then be larger than `buffer_len`.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return std::size_t combined size of the trailing tags, 0 if none.
+ */
+std::size_t GetAudioTrailingMetadataSize(const uint8_t* buffer, size_t buffer_len);
+
 }  // namespace parakeet_audio
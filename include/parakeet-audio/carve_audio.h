@@ -0,0 +1,39 @@
+#pragma once
+
+#include "audio_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parakeet_audio {
+
+struct AudioCarveCandidate {
+  std::size_t offset;
+  AudioType type;
+
+  /**
+   * @brief Estimated stream length in bytes, starting from `offset`.
+   *        Taken from the container (chunk size, page/frame walk etc.) when
+   *        available, otherwise runs up to the next candidate or the end of buffer.
+   */
+  std::size_t estimated_len;
+};
+
+/**
+ * @brief Scan `buffer` for all embedded audio streams, at any offset.
+ *        `buffer` can be a memory-mapped file of arbitrary size.
+ *
+ *        Streams with a known length are skipped over once accepted, so pages or frames
+ *        within an accepted stream are not reported again.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @param thread_count Split the scan across this many threads. 0 or 1 scans on the calling thread.
+ * @return std::vector<AudioCarveCandidate> candidates, sorted by offset.
+ */
+std::vector<AudioCarveCandidate> CarveAudioStreams(const uint8_t* buffer,
+                                                   std::size_t buffer_len,
+                                                   std::size_t thread_count = 1);
+
+}  // namespace parakeet_audio
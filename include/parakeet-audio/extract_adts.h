@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parakeet_audio {
+constexpr std::size_t kADTSHeaderSize = 7;
+
+/**
+ * @brief A single AAC access unit in the source file, to be sent after its ADTS header.
+ */
+struct ADTSSampleRange {
+  uint64_t offset;  // Absolute offset in the source file.
+  uint32_t size;
+};
+
+/**
+ * @brief ADTS stream planned from a MP4/M4A file, without copying any sample data.
+ *        Frame `i` is `headers[i * kADTSHeaderSize .. +kADTSHeaderSize]` followed by `samples[i]`.
+ */
+struct ADTSStreamPlan {
+  std::vector<uint8_t> headers;
+  std::vector<ADTSSampleRange> samples;
+
+  uint32_t sample_rate;
+  uint32_t channels;
+
+  [[nodiscard]] std::size_t GetStreamSize() const {
+    std::size_t total = headers.size();
+    for (const auto& sample : samples) {
+      total += sample.size;
+    }
+    return total;
+  }
+};
+
+/**
+ * @brief `iovec` compatible range: header bytes, or sample bytes in the source buffer.
+ */
+struct ADTSIOVec {
+  const void* base;
+  std::size_t len;
+};
+
+/**
+ * @brief Plan an ADTS elementary stream from the first AAC track of a MP4/M4A file.
+ *        Reads `stsd/esds` for the AudioSpecificConfig and `stsz`/`stsc`/`stco`/`co64` for the sample table.
+ *        Fragmented MP4 (`moof`) is not supported.
+ *
+ * @param buffer The whole file (e.g. memory-mapped), sample offsets are checked against it.
+ * @param buffer_len
+ * @return ADTSStreamPlan with empty `samples` if there is no AAC track, or it can't be expressed in ADTS.
+ */
+ADTSStreamPlan PlanADTSStreamFromMP4(const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Interleave ADTS headers and sample ranges of `buffer` for `writev`.
+ *        Both `plan` and `buffer` must outlive the returned list.
+ *
+ * @param plan
+ * @param buffer The same buffer passed to `PlanADTSStreamFromMP4`.
+ * @return std::vector<ADTSIOVec>
+ */
+inline std::vector<ADTSIOVec> GetADTSStreamIOVecs(const ADTSStreamPlan& plan, const uint8_t* buffer) {
+  std::vector<ADTSIOVec> iovecs;
+  iovecs.reserve(plan.samples.size() * 2);
+  for (std::size_t i = 0; i < plan.samples.size(); i++) {
+    iovecs.push_back({&plan.headers[i * kADTSHeaderSize], kADTSHeaderSize});
+    iovecs.push_back({&buffer[plan.samples[i].offset], plan.samples[i].size});
+  }
+  return iovecs;
+}
+
+}  // namespace parakeet_audio
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parakeet_audio {
+
+constexpr uint8_t kID3v2FlagUnsynchronisation = 0x80;
+constexpr uint8_t kID3v2FlagExtendedHeader = 0x40;
+constexpr uint8_t kID3v2FlagFooter = 0x10;
+
+// ID3v2.4 frame format flags.
+constexpr uint16_t kID3v2FrameFlagUnsynchronisation = 0x0002;
+constexpr uint16_t kID3v2FrameFlagDataLengthIndicator = 0x0001;
+
+struct ID3v2Frame {
+  uint32_t id;  // e.g. 'APIC' as big endian.
+  uint16_t flags;
+
+  /**
+   * @brief Frame content with unsynchronisation reversed, pointing into the decoded buffer.
+   *        Optional fields announced by `flags` (grouping id, data length indicator...) are kept.
+   */
+  const uint8_t* data;
+  std::size_t data_len;
+};
+
+struct ID3v2Tag {
+  uint8_t version;  // 3 or 4, 0 if not a supported ID3v2 tag.
+  uint8_t flags;
+
+  std::size_t tag_size;  // On disk, with header and footer.
+  std::vector<ID3v2Frame> frames;
+};
+
+/**
+ * @brief Reverse ID3v2 unsynchronisation in place: every `FF 00` becomes `FF`.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return std::size_t Length of the decoded data, at the start of `buffer`.
+ */
+std::size_t RemoveID3Unsynchronisation(uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Decode the ID3v2.3/v2.4 tag at the start of `buffer` in place and list its frames.
+ *        Unsynchronisation (tag-wide, or per frame in v2.4) is reversed and the extended header skipped.
+ *        Bytes of the tag are rewritten; nothing past `tag_size` is touched.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return ID3v2Tag `version` is 0 if no complete v2.3/v2.4 tag was found.
+ */
+ID3v2Tag DecodeID3v2TagInPlace(uint8_t* buffer, std::size_t buffer_len);
+
+}  // namespace parakeet_audio
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "audio_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <utility>
+#include <vector>
+
+namespace parakeet_audio {
+constexpr uint64_t kAudioProbeHeadSize = 64 * 1024;
+constexpr uint64_t kAudioProbeTailSize = 64 * 1024;
+
+// Ranges closer than this are read as one.
+constexpr uint64_t kAudioProbeCoalesceGap = 64 * 1024;
+
+// Give up after this many round-trips (only reached by unusual MP4 box layouts).
+constexpr std::size_t kAudioProbeMaxRoundTrips = 4;
+
+struct AudioByteRange {
+  uint64_t offset;
+  uint64_t length;
+};
+
+/**
+ * @brief Random access to a file of known size through a range-read callback, e.g. an object store.
+ *        Reads may return fewer bytes than asked for; exceptions thrown by the callback propagate.
+ */
+class AudioRangeReader {
+ public:
+  using BufferFuture = std::future<std::vector<uint8_t>>;
+  using SyncRead = std::function<std::vector<uint8_t>(uint64_t offset, uint64_t length)>;
+  using FutureRead = std::function<BufferFuture(uint64_t offset, uint64_t length)>;
+  using CallbackRead = std::function<
+      void(uint64_t offset, uint64_t length, std::function<void(std::vector<uint8_t>)> on_complete)>;
+
+  /**
+   * @brief Blocking callback. Each read runs on its own thread, so ranges are still read concurrently.
+   */
+  static AudioRangeReader FromSync(uint64_t file_size, SyncRead read);
+  static AudioRangeReader FromFuture(uint64_t file_size, FutureRead read);
+
+  /**
+   * @brief Completion callback, `on_complete` may be called from any thread.
+   */
+  static AudioRangeReader FromCallback(uint64_t file_size, CallbackRead read);
+
+  [[nodiscard]] uint64_t GetFileSize() const { return file_size_; }
+  [[nodiscard]] BufferFuture Read(const AudioByteRange& range) const { return read_(range.offset, range.length); }
+
+ private:
+  AudioRangeReader(uint64_t file_size, FutureRead read) : file_size_(file_size), read_(std::move(read)) {}
+
+  uint64_t file_size_;
+  FutureRead read_;
+};
+
+struct AudioProbeResult {
+  AudioType type;
+
+  /**
+   * @brief The audio stream, without leading ID3v2/APEv2 or trailing ID3v1/APEv2 tags.
+   */
+  AudioByteRange payload;
+
+  double duration;  // In seconds, 0 if unknown.
+
+  std::size_t round_trips;
+  uint64_t bytes_read;
+};
+
+/**
+ * @brief Sort and merge ranges that overlap or are less than `max_gap` bytes apart.
+ *
+ * @param ranges
+ * @param max_gap
+ * @return std::vector<AudioByteRange>
+ */
+std::vector<AudioByteRange> CoalesceByteRanges(std::vector<AudioByteRange> ranges, uint64_t max_gap);
+
+/**
+ * @brief Ranges for the first probe round-trip: head and tail of the file, coalesced.
+ *
+ * @param file_size
+ * @return std::vector<AudioByteRange>
+ */
+std::vector<AudioByteRange> PlanAudioProbeRanges(uint64_t file_size);
+
+/**
+ * @brief Detect audio type, payload range and duration of the file behind `reader`.
+ *        The head and tail are read concurrently in one round-trip; a second is only needed when a
+ *        large leading tag pushes the stream out of the head, or a MP4 `moov` box is out of reach.
+ *
+ * @param reader
+ * @return AudioProbeResult
+ */
+AudioProbeResult ProbeAudio(const AudioRangeReader& reader);
+
+}  // namespace parakeet_audio
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "audio_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+constexpr std::size_t kAudioScoreBlockSize = 4096;
+constexpr std::size_t kAudioScoreBlockCount = 8;
+
+struct AudioPayloadScore {
+  AudioType type;
+  std::size_t payload_offset;  // Start of the payload, after an optional ID3/APEv2 tag and FLAC metadata.
+
+  /**
+   * @brief Bytes in the sampled blocks, plus those of Ogg pages / FLAC frames checked past the end of
+   *        a block.
+   */
+  std::size_t bytes_sampled;
+
+  double entropy;  // Shannon entropy of the sampled bytes, in bits per byte.
+
+  /**
+   * @brief Chi-square statistic of the sampled byte histogram against uniformly random bytes,
+   *        normalised to a z-score. Random bytes stay within a few units of 0; compressed audio,
+   *        with its frame headers, side info and padding, scores far higher.
+   */
+  double randomness_z;
+
+  /**
+   * @brief Share of sampled blocks holding valid structure: MP3/ADTS frame runs, or Ogg pages / FLAC
+   *        frames passing their CRC. Negative if the type has no structure we can check.
+   */
+  double structure_rate;
+
+  /**
+   * @brief 0 for random bytes, 1 for payload looking like valid audio.
+   */
+  double score;
+};
+
+/**
+ * @brief Score how likely the decrypted payload in `buffer` is valid audio, rather than random bytes
+ *        left by a wrong key. Samples `block_count` blocks of `block_size` spread over the payload.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @param block_size
+ * @param block_count
+ * @return AudioPayloadScore
+ */
+AudioPayloadScore ScoreAudioPayload(const uint8_t* buffer,
+                                    std::size_t buffer_len,
+                                    std::size_t block_size = kAudioScoreBlockSize,
+                                    std::size_t block_count = kAudioScoreBlockCount);
+
+}  // namespace parakeet_audio
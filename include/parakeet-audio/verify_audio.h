@@ -0,0 +1,81 @@
+#pragma once
+
+#include "audio_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+struct AudioIntegrityReport {
+  /**
+   * @brief Detected audio type. Only Ogg (page CRC-32) and FLAC (frame CRC-8/CRC-16) are checked,
+   *        `units_checked` is 0 for any other type.
+   */
+  AudioType type;
+
+  std::size_t units_checked;  // Ogg pages / FLAC frames
+  std::size_t units_valid;
+
+  /**
+   * @brief Offset of the first unit failing its checksum (or structure check),
+   *        `buffer_len` if none failed.
+   */
+  std::size_t first_error_offset;
+
+  /**
+   * @brief End of the last unit passing its checksum, 0 if none passed.
+   */
+  std::size_t checked_end;
+};
+
+// How far an Ogg page or FLAC frame may run past the end of the block in `VerifyAudioIntegrityBlock`.
+// Covers the largest Ogg page (27 + 255 + 255 * 255 bytes).
+constexpr std::size_t kAudioIntegrityBlockOverrun = 64 * 1024;
+
+/**
+ * @brief Verify every Ogg page or FLAC frame of the file in `buffer`, stopping at the first failure.
+ *        Leading ID3v2/APEv2 and trailing ID3v1/APEv2 tags are skipped.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return AudioIntegrityReport
+ */
+AudioIntegrityReport VerifyAudioIntegrity(const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Verify up to `sample_count` Ogg pages or FLAC frames, spread evenly over `buffer`.
+ *        Each sample resyncs to the next unit from its position, and keeps going after failures.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @param sample_count
+ * @return AudioIntegrityReport
+ */
+AudioIntegrityReport SampleAudioIntegrity(const uint8_t* buffer, std::size_t buffer_len, std::size_t sample_count);
+
+/**
+ * @brief Verify the Ogg pages or FLAC frames starting in `[block_start, block_end)`, resyncing inside
+ *        the block only. Units must end within `kAudioIntegrityBlockOverrun` bytes past `block_end`,
+ *        so the cost does not depend on `buffer_len`.
+ *
+ * @param buffer
+ * @param buffer_len
+ * @param block_start
+ * @param block_end
+ * @return AudioIntegrityReport
+ */
+AudioIntegrityReport VerifyAudioIntegrityBlock(const uint8_t* buffer,
+                                               std::size_t buffer_len,
+                                               std::size_t block_start,
+                                               std::size_t block_end);
+
+inline double GetValidUnitPercentage(const AudioIntegrityReport& report) {
+  constexpr double kPercent = 100.0;
+  if (report.units_checked == 0) {
+    return 0.0;
+  }
+  return kPercent * static_cast<double>(report.units_valid) / static_cast<double>(report.units_checked);
+}
+
+}  // namespace parakeet_audio
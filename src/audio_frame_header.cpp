@@ -0,0 +1,225 @@
+#include "audio_frame_header.h"
+#include "parakeet_crc.h"
+#include "parakeet_endian.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+namespace {
+
+// Index: [is_mpeg1 ? 0 : 1][layer - 1][bitrate_index], kbit/s.
+constexpr std::array<std::array<std::array<uint16_t, 16>, 3>, 2> kMPEGBitrateTable = {{
+    {{
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},  // MPEG-1 Layer I
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},     // MPEG-1 Layer II
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},      // MPEG-1 Layer III
+    }},
+    {{
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},  // MPEG-2/2.5 Layer I
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},       // MPEG-2/2.5 Layer II
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},       // MPEG-2/2.5 Layer III
+    }},
+}};
+
+// Index: [version_bits][sample_rate_index]; version_bits of 0b01 is reserved.
+constexpr std::array<std::array<uint32_t, 3>, 4> kMPEGSampleRateTable = {{
+    {11025, 12000, 8000},   // MPEG-2.5
+    {0, 0, 0},              // reserved
+    {22050, 24000, 16000},  // MPEG-2
+    {44100, 48000, 32000},  // MPEG-1
+}};
+
+constexpr std::array<uint32_t, 16> kADTSSampleRateTable = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350, 0, 0, 0,
+};
+
+}  // namespace
+
+AudioFrameInfo ParseMPEGAudioFrameHeader(const uint8_t* buffer, std::size_t buffer_len) {
+  // AAAAAAAA AAABBCCD EEEEFFGH IIJJKLMM
+  //   A: frame sync, B: version, C: layer, D: protection
+  //   E: bitrate index, F: sample rate index, G: padding
+  constexpr std::size_t kHeaderSize = 4;
+  constexpr uint32_t kVersionMPEG1 = 0b11;
+  constexpr uint32_t kVersionReserved = 0b01;
+  constexpr uint32_t kBitrateIndexBad = 0b1111;
+  constexpr uint32_t kSampleRateIndexReserved = 0b11;
+  constexpr uint32_t kBitsPerKilobit = 1000;
+
+  // Samples per frame; a frame holds `sample_count / 8 * bitrate / sample_rate` bytes, counted in slots
+  // of 4 bytes for Layer I.
+  constexpr uint32_t kLayer1SampleCount = 384;
+  constexpr uint32_t kMPEG2Layer3SampleCount = 576;
+  constexpr uint32_t kSampleCount = 1152;
+  constexpr uint32_t kBitsPerByte = 8;
+  constexpr uint32_t kLayer1SlotSize = 4;
+
+  if (buffer_len < kHeaderSize || buffer[0] != kFrameSyncByte0 ||
+      (buffer[1] & kMPEGAudioSyncMask1) != kMPEGAudioSync1) {
+    return {};
+  }
+
+  const uint32_t version = (buffer[1] >> 3) & 0b11;
+  const uint32_t layer = 4 - ((buffer[1] >> 1) & 0b11);  // 0b11 = Layer I, 0b01 = Layer III
+  const uint32_t bitrate_index = buffer[2] >> 4;
+  const uint32_t sample_rate_index = (buffer[2] >> 2) & 0b11;
+  const uint32_t padding = (buffer[2] >> 1) & 0b1;
+
+  // Reject reserved version, reserved layer, free/bad bitrate and reserved sample rate.
+  if (version == kVersionReserved || layer == 4 || bitrate_index == 0 || bitrate_index == kBitrateIndexBad ||
+      sample_rate_index == kSampleRateIndexReserved) {
+    return {};
+  }
+
+  const bool is_mpeg1 = version == kVersionMPEG1;
+  const uint32_t bitrate = kMPEGBitrateTable[is_mpeg1 ? 0 : 1][layer - 1][bitrate_index] * kBitsPerKilobit;
+  const uint32_t sample_rate = kMPEGSampleRateTable[version][sample_rate_index];
+
+  AudioFrameInfo info{};
+  info.sample_rate = sample_rate;
+  if (layer == 1) {
+    info.sample_count = kLayer1SampleCount;
+    info.frame_size =
+        (kLayer1SampleCount / kBitsPerByte / kLayer1SlotSize * bitrate / sample_rate + padding) * kLayer1SlotSize;
+  } else {
+    info.sample_count = layer == 3 && !is_mpeg1 ? kMPEG2Layer3SampleCount : kSampleCount;
+    info.frame_size = info.sample_count / kBitsPerByte * bitrate / sample_rate + padding;
+  }
+  return info;
+}
+
+AudioFrameInfo ParseADTSFrameHeader(const uint8_t* buffer, std::size_t buffer_len) {
+  // AAAAAAAA AAAABCCD EEFFFFGH HHIJKLMM MMMMMMMM MMMOOOOO OOOOOOPP
+  //   A: sync, B: id, C: layer (always 0), D: protection absent
+  //   E: profile, F: sample rate index, M: frame length (incl. header), P: raw data blocks - 1
+  constexpr std::size_t kHeaderSize = 7;
+  constexpr std::size_t kHeaderWithCRCSize = 9;
+  constexpr uint32_t kSamplesPerRawDataBlock = 1024;
+  constexpr uint32_t kSampleRateIndexMask = 0b1111;
+
+  // M: 13 bits, ending 5 bits into the 4 bytes from offset 2.
+  constexpr std::size_t kOffsetFrameLength = 2;
+  constexpr uint32_t kFrameLengthShift = 5;
+  constexpr uint32_t kFrameLengthMask = 0x1FFF;
+  constexpr std::size_t kOffsetRawDataBlocks = 6;
+
+  if (buffer_len < kHeaderSize || buffer[0] != kFrameSyncByte0 || (buffer[1] & kADTSSyncMask1) != kADTSSync1) {
+    return {};
+  }
+
+  const uint32_t sample_rate = kADTSSampleRateTable[(buffer[2] >> 2) & kSampleRateIndexMask];
+  const std::size_t frame_size =
+      (ReadBigEndian<uint32_t>(&buffer[kOffsetFrameLength]) >> kFrameLengthShift) & kFrameLengthMask;
+  const bool protection_absent = (buffer[1] & 0b1) != 0;
+
+  if (sample_rate == 0 || frame_size < (protection_absent ? kHeaderSize : kHeaderWithCRCSize)) {
+    return {};
+  }
+
+  AudioFrameInfo info{};
+  info.frame_size = frame_size;
+  info.sample_rate = sample_rate;
+  info.sample_count = ((buffer[kOffsetRawDataBlocks] & 0b11) + 1) * kSamplesPerRawDataBlock;
+  return info;
+}
+
+std::size_t GetOggPageSize(const uint8_t* buffer, std::size_t buffer_len) {
+  // offset    value
+  //      0    header('OggS')
+  //      4    uint8_t(version), always 0
+  //      5    uint8_t(header_type)
+  //      6    uint64_t(granule_position)
+  //     14    uint32_t(serial), uint32_t(page_seq), uint32_t(crc)
+  //     26    uint8_t(segment_count)
+  //     27    uint8_t[segment_count] segment_table
+  //     ??    byte[sum(segment_table)] page_data
+  constexpr uint32_t kMagicOggS = 0x4F'67'67'53U;
+  constexpr std::size_t kOggPageHeaderSize = 27;
+  constexpr std::size_t kOffsetVersion = 4;
+  constexpr std::size_t kOffsetSegmentCount = 26;
+
+  if (buffer_len < kOggPageHeaderSize || ReadBigEndian<uint32_t>(buffer) != kMagicOggS ||
+      buffer[kOffsetVersion] != 0) {
+    return 0;
+  }
+
+  const std::size_t segment_count = buffer[kOffsetSegmentCount];
+  if (buffer_len < kOggPageHeaderSize + segment_count) {
+    return 0;
+  }
+
+  std::size_t page_size = kOggPageHeaderSize + segment_count;
+  const uint8_t* segment_table = &buffer[kOggPageHeaderSize];
+  for (std::size_t i = 0; i < segment_count; i++) {
+    page_size += segment_table[i];
+  }
+  return page_size;
+}
+
+std::size_t GetFLACFrameHeaderSize(const uint8_t* buffer, std::size_t buffer_len) {
+  // offset    value
+  //      0    uint16_t(sync=0b1111'1111'1111'100 << 1 | blocking_strategy)
+  //      2    uint4_t(block_size_code) uint4_t(sample_rate_code)
+  //      3    uint4_t(channels) uint3_t(sample_size) uint1_t(reserved=0)
+  //      4    utf8-coded frame/sample number (1-7 bytes)
+  //     ??    uint8_t/uint16_t block size, if block_size_code is 6/7
+  //     ??    uint8_t/uint16_t sample rate, if sample_rate_code is 12/13/14
+  //     ??    uint8_t(crc8)
+  constexpr std::size_t kFixedHeaderSize = 4;
+  constexpr uint32_t kBlockSizeReserved = 0;
+  constexpr uint32_t kBlockSize8Bit = 6;
+  constexpr uint32_t kBlockSize16Bit = 7;
+  constexpr uint32_t kSampleRate8Bit = 12;
+  constexpr uint32_t kSampleRateInvalid = 15;
+  constexpr uint32_t kChannelsMax = 10;
+  constexpr uint32_t kSampleSizeReserved = 3;
+  constexpr uint32_t kSampleRateCodeMask = 0x0F;
+  constexpr uint32_t kSampleSizeMask = 0b111;
+  constexpr uint8_t kNumberLeadBit = 0x80;
+  constexpr std::size_t kNumberMaxLen = 7;
+
+  if (buffer_len < kFixedHeaderSize + 2 || buffer[0] != kFrameSyncByte0 || (buffer[1] & kFLACSyncMask1) != kFLACSync1) {
+    return 0;
+  }
+
+  const uint32_t block_size_code = buffer[2] >> 4;
+  const uint32_t sample_rate_code = buffer[2] & kSampleRateCodeMask;
+  if (block_size_code == kBlockSizeReserved || sample_rate_code == kSampleRateInvalid ||
+      (buffer[3] >> 4) > kChannelsMax || ((buffer[3] >> 1) & kSampleSizeMask) == kSampleSizeReserved ||
+      (buffer[3] & 0b1) != 0) {
+    return 0;
+  }
+
+  // UTF-8 style number: leading 1-bits of the first byte give the total length.
+  std::size_t number_len = 1;
+  if (const uint8_t lead = buffer[kFixedHeaderSize]; (lead & kNumberLeadBit) != 0) {
+    while (number_len <= kNumberMaxLen && (lead & (kNumberLeadBit >> number_len)) != 0) {
+      number_len++;
+    }
+    if (number_len == 1 || number_len > kNumberMaxLen) {
+      return 0;
+    }
+  }
+
+  std::size_t header_len = kFixedHeaderSize + number_len;
+  if (block_size_code == kBlockSize8Bit) {
+    header_len += 1;
+  } else if (block_size_code == kBlockSize16Bit) {
+    header_len += 2;
+  }
+  if (sample_rate_code == kSampleRate8Bit) {
+    header_len += 1;
+  } else if (sample_rate_code > kSampleRate8Bit) {
+    header_len += 2;
+  }
+
+  if (buffer_len <= header_len || UpdateFLACCRC8(0, buffer, header_len) != buffer[header_len]) {
+    return 0;
+  }
+  return header_len + 1;
+}
+
+}  // namespace parakeet_audio
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+// Frame sync codes: the first byte is kFrameSyncByte0, the second matches `kXXXSync1` under `kXXXSyncMask1`.
+constexpr uint8_t kFrameSyncByte0 = 0xFF;
+constexpr uint8_t kMPEGAudioSyncMask1 = 0xE0;  // 11-bit sync
+constexpr uint8_t kMPEGAudioSync1 = 0xE0;
+constexpr uint8_t kADTSSyncMask1 = 0xF6;  // 12-bit sync, layer 0
+constexpr uint8_t kADTSSync1 = 0xF0;
+constexpr uint8_t kFLACSyncMask1 = 0xFE;  // 15-bit sync, any blocking strategy
+constexpr uint8_t kFLACSync1 = 0xF8;
+
+/**
+ * @brief Information extracted from a single MPEG audio / ADTS frame header.
+ * @private
+ */
+struct AudioFrameInfo {
+  std::size_t frame_size;  // 0 when the header is invalid.
+  uint32_t sample_rate;
+  uint32_t sample_count;
+};
+
+/**
+ * @brief Parse MPEG-1/2/2.5 Layer I/II/III frame header.
+ * @private
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return AudioFrameInfo `frame_size` is 0 if not a valid frame header.
+ */
+AudioFrameInfo ParseMPEGAudioFrameHeader(const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Parse ADTS (AAC) frame header.
+ * @private
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return AudioFrameInfo `frame_size` is 0 if not a valid frame header.
+ */
+AudioFrameInfo ParseADTSFrameHeader(const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Get the size of the Ogg page at the start of `buffer`, including its header.
+ * @private
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return std::size_t 0 if not a valid Ogg page, or the page header does not fit in `buffer`.
+ */
+std::size_t GetOggPageSize(const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Get the size of the FLAC frame header at the start of `buffer`, including its CRC-8.
+ * @private
+ *
+ * @param buffer
+ * @param buffer_len
+ * @return std::size_t 0 if not a valid frame header, or its CRC-8 does not match.
+ */
+std::size_t GetFLACFrameHeaderSize(const uint8_t* buffer, std::size_t buffer_len);
+
+}  // namespace parakeet_audio
@@ -1,6 +1,8 @@
 #include "parakeet-audio/audio_metadata.h"
 #include "parakeet_endian.h"
 
+#include "parakeet-audio/id3v2_tag.h"
+
 #include <algorithm>
 #include <array>
 #include <cstddef>
@@ -48,11 +50,19 @@ std::size_t GetID3HeaderSize(const uint8_t* buffer, size_t buffer_len) {
     //      5    uint8_t(flags)
     //      6    uint32_t(inner_tag_size)
     //     10    byte[inner_tag_size] id3v2 data
+    //     ??    byte[10] footer ('3DI'), v2.4 only, if flags has kID3v2FlagFooter
     //     ??    byte[*] original_file_content
 
     if (const auto inner_size = ParseID3SyncSafeInt(buffer + 6); inner_size > 0) {
       constexpr std::size_t kID3V2HeaderSize = 10;
-      return kID3V2HeaderSize + inner_size;
+      constexpr std::size_t kID3V2FooterSize = 10;
+      constexpr std::size_t kOffsetVersion = 3;
+      constexpr std::size_t kOffsetFlags = 5;
+      constexpr uint8_t kFooterMinVersion = 4;
+
+      const bool has_footer =
+          buffer[kOffsetVersion] >= kFooterMinVersion && (buffer[kOffsetFlags] & kID3v2FlagFooter) != 0;
+      return kID3V2HeaderSize + inner_size + (has_footer ? kID3V2FooterSize : 0);
     }
   }
 
@@ -87,4 +97,62 @@ std::size_t GetAudioHeaderMetadataSize(const uint8_t* buffer, size_t buffer_len)
   return 0;
 }
 
+std::size_t GetFLACMetadataSize(const uint8_t* buffer, size_t buffer_len) {
+  // "fLaC", followed by metadata blocks: uint1_t(is_last) uint7_t(type) uint24_t(len) byte[len]
+  constexpr std::array<uint8_t, 4> kFLACMagic = {'f', 'L', 'a', 'C'};
+  constexpr std::size_t kBlockHeaderSize = 4;
+  constexpr uint32_t kBlockFlagIsLast = 0x8000'0000;
+  constexpr uint32_t kBlockLengthMask = 0x00FF'FFFF;
+
+  if (buffer_len < kFLACMagic.size() || !std::equal(kFLACMagic.begin(), kFLACMagic.end(), buffer)) {
+    return 0;
+  }
+
+  std::size_t pos = kFLACMagic.size();
+  bool is_last = false;
+  while (!is_last) {
+    if (buffer_len - pos < kBlockHeaderSize) {
+      return 0;
+    }
+    const auto block_header = ReadBigEndian<uint32_t>(&buffer[pos]);
+    const std::size_t block_len = block_header & kBlockLengthMask;
+    is_last = (block_header & kBlockFlagIsLast) != 0;
+    if (buffer_len - pos - kBlockHeaderSize < block_len) {
+      return 0;
+    }
+    pos += kBlockHeaderSize + block_len;
+  }
+  return pos;
+}
+
+std::size_t GetAudioTrailingMetadataSize(const uint8_t* buffer, size_t buffer_len) {
+  // [APEv2 tag][ID3v1 tag] EOF, either of them optional.
+  constexpr std::size_t kID3v1Size = 128;
+  constexpr std::size_t kAPEv2FooterSize = 32;
+  constexpr std::size_t kOffsetAPEv2TagSize = 12;
+  constexpr std::size_t kOffsetAPEv2Flags = 20;
+  constexpr uint32_t kAPEv2FlagHasHeader = 1U << 31;
+  constexpr std::array<uint8_t, 3> kID3v1Magic = {'T', 'A', 'G'};
+  constexpr std::array<uint8_t, 8> kAPEv2Magic = {'A', 'P', 'E', 'T', 'A', 'G', 'E', 'X'};
+
+  std::size_t trailing_size = 0;
+  if (buffer_len >= kID3v1Size &&
+      std::equal(kID3v1Magic.begin(), kID3v1Magic.end(), &buffer[buffer_len - kID3v1Size])) {
+    trailing_size += kID3v1Size;
+  }
+
+  if (buffer_len - trailing_size >= kAPEv2FooterSize) {
+    const uint8_t* footer = &buffer[buffer_len - trailing_size - kAPEv2FooterSize];
+    if (std::equal(kAPEv2Magic.begin(), kAPEv2Magic.end(), footer)) {
+      // Tag size in bytes including footer and all tag items excluding the header.
+      trailing_size += ReadLittleEndian<uint32_t>(&footer[kOffsetAPEv2TagSize]);
+      if ((ReadLittleEndian<uint32_t>(&footer[kOffsetAPEv2Flags]) & kAPEv2FlagHasHeader) != 0) {
+        trailing_size += kAPEv2FooterSize;
+      }
+    }
+  }
+
+  return trailing_size;
+}
+
 }  // namespace parakeet_audio
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "parakeet_crc.h"
+#include "parakeet_endian.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+// Builders for synthetic audio shared by the tests.
+namespace parakeet_audio::test {
+
+// MPEG-1 Layer III, 128kbps, 44.1kHz, joint stereo, no padding: 417 bytes per frame.
+constexpr std::size_t kMP3FrameSize = 417;
+constexpr uint32_t kMP3FrameHeader = 0xFFFB9064;
+
+/**
+ * @brief Next byte of a linear congruential generator; reproducible noise standing in for
+ *        compressed audio, or for a payload decrypted with a wrong key.
+ */
+inline uint8_t NextNoise(uint32_t& seed) {
+  seed = seed * 1103515245U + 12345U;
+  return static_cast<uint8_t>(seed >> 16);
+}
+
+inline void FillNoise(uint8_t* buffer, std::size_t len, uint32_t seed) {
+  std::generate_n(buffer, len, [&seed]() { return NextNoise(seed); });
+}
+
+/**
+ * @brief Write `frame_count` back to back MP3 frame headers at `buffer`, leaving the frame bodies alone.
+ */
+inline void WriteMP3Frames(uint8_t* buffer, std::size_t frame_count) {
+  for (std::size_t i = 0; i < frame_count; i++) {
+    WriteBigEndian<uint32_t>(&buffer[i * kMP3FrameSize], kMP3FrameHeader);
+  }
+}
+
+/**
+ * @brief Write an Ogg page header at `page` with `segment_count` segments of `segment_len` bytes, then
+ *        its CRC over the body already in place after the header.
+ * @return std::size_t Size of the page.
+ */
+inline std::size_t WriteOggPage(uint8_t* page,
+                                std::size_t segment_count,
+                                uint8_t segment_len,
+                                uint64_t granule = 0,
+                                uint32_t sequence = 0) {
+  constexpr std::size_t kHeaderSize = 27;
+  std::fill_n(page, kHeaderSize, 0);
+  std::copy_n("OggS", 4, page);
+  WriteLittleEndian<uint64_t>(&page[6], granule);
+  WriteLittleEndian<uint32_t>(&page[18], sequence);
+  page[26] = static_cast<uint8_t>(segment_count);
+  std::fill_n(&page[kHeaderSize], segment_count, segment_len);
+
+  const std::size_t page_size = kHeaderSize + segment_count + segment_count * segment_len;
+  WriteLittleEndian<uint32_t>(&page[22], UpdateOggCRC32(0, page, page_size));
+  return page_size;
+}
+
+/**
+ * @brief "fLaC" and a zeroed STREAMINFO block, then a PICTURE block of `picture_len` noise bytes, standing
+ *        in for cover art, unless 0.
+ */
+inline std::vector<uint8_t> MakeFLACStreamHeader(std::size_t picture_len = 0) {
+  constexpr uint8_t kLastBlockFlag = 0x80;
+  constexpr uint8_t kBlockTypePicture = 6;
+  constexpr uint8_t kStreamInfoSize = 34;
+
+  std::vector<uint8_t> buffer = {'f', 'L', 'a', 'C', kLastBlockFlag, 0x00, 0x00, kStreamInfoSize};
+  buffer.resize(buffer.size() + kStreamInfoSize);
+  if (picture_len != 0) {
+    buffer[4] = 0x00;
+    const std::size_t offset = buffer.size();
+    buffer.resize(offset + 4 + picture_len);
+    WriteBigEndian<uint32_t>(&buffer[offset], static_cast<uint32_t>(picture_len));
+    buffer[offset] = kLastBlockFlag | kBlockTypePicture;
+    FillNoise(&buffer[offset + 4], picture_len, 0xC0DE);
+  }
+  return buffer;
+}
+
+// FLAC frame: 192 samples @ 44.1kHz, stereo, 16-bit; `data_len` noise bytes in place of subframes.
+inline std::size_t AppendFLACFrame(std::vector<uint8_t>& buffer,
+                                   uint8_t frame_number,
+                                   std::size_t data_len,
+                                   uint32_t& seed) {
+  const std::size_t offset = buffer.size();
+  const std::array<uint8_t, 5> header = {0xFF, 0xF8, 0x19, 0x18, frame_number};
+  buffer.insert(buffer.end(), header.begin(), header.end());
+  buffer.push_back(UpdateFLACCRC8(0, header.data(), header.size()));
+  for (std::size_t i = 0; i < data_len; i++) {
+    buffer.push_back(NextNoise(seed));
+  }
+
+  const auto crc = UpdateFLACCRC16(0, &buffer[offset], buffer.size() - offset);
+  buffer.push_back(static_cast<uint8_t>(crc >> 8));
+  buffer.push_back(static_cast<uint8_t>(crc));
+  return offset;
+}
+
+inline std::vector<uint8_t> U32BE(uint32_t value) {
+  std::vector<uint8_t> result(4);
+  WriteBigEndian<uint32_t>(result.data(), value);
+  return result;
+}
+
+// MP4 box: uint32_t(size) char[4](type) payload
+inline std::vector<uint8_t> Box(const std::string& type, const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> result = U32BE(static_cast<uint32_t>(payload.size() + 8));
+  result.insert(result.end(), type.begin(), type.end());
+  result.insert(result.end(), payload.begin(), payload.end());
+  return result;
+}
+
+inline void AppendID3v1(std::vector<uint8_t>& buffer) {
+  const std::size_t offset = buffer.size();
+  buffer.resize(offset + 128, 0);
+  std::copy_n("TAG", 3, &buffer[offset]);
+}
+
+/**
+ * @brief Append an APEv2 tag of `items_len` bytes of items and its footer, with a header before the
+ *        items when `has_header` is set.
+ */
+inline void AppendAPEv2(std::vector<uint8_t>& buffer, uint32_t items_len, bool has_header = true) {
+  constexpr uint32_t kFlagHasHeader = 1U << 31;
+  const uint32_t flags = has_header ? kFlagHasHeader : 0;
+  for (bool is_header : {true, false}) {
+    if (is_header && !has_header) {
+      continue;
+    }
+    if (!is_header) {
+      buffer.resize(buffer.size() + items_len, 0x41);
+    }
+    const std::size_t offset = buffer.size();
+    buffer.resize(offset + 32, 0);
+    std::copy_n("APETAGEX", 8, &buffer[offset]);
+    WriteLittleEndian<uint32_t>(&buffer[offset + 8], 2000);
+    WriteLittleEndian<uint32_t>(&buffer[offset + 12], items_len + 32);
+    WriteLittleEndian<uint32_t>(&buffer[offset + 20], flags);
+  }
+}
+
+}  // namespace parakeet_audio::test
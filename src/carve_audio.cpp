@@ -0,0 +1,448 @@
+#include "parakeet-audio/carve_audio.h"
+#include "audio_frame_header.h"
+#include "parakeet_endian.h"
+#include "parakeet_simd.h"
+
+#include "parakeet-audio/audio_metadata.h"
+#include "parakeet-audio/detect_audio_type.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace parakeet_audio {
+
+namespace {
+
+// First byte of every signature we look for:
+//   0xFF: MP3/AAC frame sync, 'f': "fLaC" (or "ftyp" 4 bytes into a MP4 box),
+//   'O': "OggS", 'F': "FRM8", 0x30: ASF header, 'R': "RIFF", 'M': "MAC ", 'I': "ID3"
+constexpr std::array<uint8_t, 8> kCarveFirstBytes = {0xFF, 'f', 'O', 'F', 0x30, 'R', 'M', 'I'};
+
+using ByteTable = std::array<bool, UINT8_MAX + 1>;
+
+constexpr ByteTable MakeCarveFirstByteTable() {
+  ByteTable table{};
+  for (auto byte : kCarveFirstBytes) {
+    table[byte] = true;
+  }
+  return table;
+}
+constexpr ByteTable kCarveFirstByteTable = MakeCarveFirstByteTable();
+
+// Chunks smaller than this are not worth a thread.
+constexpr std::size_t kMinCarveChunkSize = 1024 * 1024;
+
+// Minimum number of back-to-back frames for MP3/AAC, unless the stream runs into the end of buffer.
+constexpr std::size_t kMinFrameRun = 3;
+
+constexpr uint32_t kMagic_ftyp = 0x66'74'79'70U;  // NOLINT(readability-identifier-naming)
+
+struct StreamExtent {
+  std::size_t length;  // 0 if the stream is not valid.
+  bool length_known;
+};
+
+struct CarveHit {
+  AudioCarveCandidate candidate;
+  bool length_known;
+};
+
+/**
+ * @brief Find the next position in `[pos, end)` holding any of `kCarveFirstBytes`.
+ * @return std::size_t `end` if not found.
+ */
+std::size_t FindNextCarveHit(const uint8_t* buffer, std::size_t pos, std::size_t end) {
+#if PARAKEET_AUDIO_HAS_SSE2
+  constexpr std::size_t kBlockSize = sizeof(__m128i);
+
+  for (; pos + kBlockSize <= end; pos += kBlockSize) {
+    // NOLINTNEXTLINE(*-type-reinterpret-cast)
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos]));
+    __m128i matches = _mm_setzero_si128();
+    for (auto needle : kCarveFirstBytes) {
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(needle))));
+    }
+
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches)); mask != 0) {
+      return pos + detail::CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  for (; pos < end; pos++) {
+    if (kCarveFirstByteTable[buffer[pos]]) {
+      return pos;
+    }
+  }
+  return end;
+}
+
+template <typename FrameParser>
+StreamExtent WalkFrames(const uint8_t* buffer, std::size_t buffer_len, FrameParser parse_frame) {
+  std::size_t pos = 0;
+  std::size_t frames = 0;
+  uint32_t sample_rate = 0;
+
+  while (pos < buffer_len) {
+    const auto info = parse_frame(&buffer[pos], buffer_len - pos);
+    if (info.frame_size == 0 || (frames > 0 && info.sample_rate != sample_rate)) {
+      break;
+    }
+
+    // Last frame cut short by the end of buffer.
+    if (info.frame_size > buffer_len - pos) {
+      pos = frames > 0 ? buffer_len : 0;
+      break;
+    }
+
+    sample_rate = info.sample_rate;
+    pos += info.frame_size;
+    frames++;
+  }
+
+  if (frames >= kMinFrameRun || (frames > 0 && pos == buffer_len)) {
+    return {pos, true};
+  }
+  return {};
+}
+
+StreamExtent WalkOggPages(const uint8_t* buffer, std::size_t buffer_len) {
+  std::size_t pos = 0;
+  while (pos < buffer_len) {
+    const auto page_size = GetOggPageSize(&buffer[pos], buffer_len - pos);
+    if (page_size == 0) {
+      break;
+    }
+    pos = std::min(pos + page_size, buffer_len);
+  }
+  return {pos, true};
+}
+
+StreamExtent WalkMP4Boxes(const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr std::size_t kBoxHeaderSize = 8;
+  constexpr std::size_t kBoxLargeHeaderSize = 16;
+  constexpr uint32_t kBoxSizeToEnd = 0;
+  constexpr uint32_t kBoxSizeLarge = 1;
+  constexpr std::size_t kOffsetBoxType = 4;
+
+  // Box types are printable ASCII.
+  constexpr uint8_t kPrintableFirst = 0x20;
+  constexpr uint8_t kPrintableLast = 0x7E;
+
+  std::size_t pos = 0;
+  while (buffer_len - pos >= kBoxHeaderSize) {
+    const uint8_t* box = &buffer[pos];
+    const bool printable_type = std::all_of(&box[kOffsetBoxType], &box[kBoxHeaderSize], [](uint8_t chr) {
+      return chr >= kPrintableFirst && chr <= kPrintableLast;
+    });
+    if (!printable_type) {
+      break;
+    }
+
+    uint64_t box_size = ReadBigEndian<uint32_t>(box);
+    if (box_size == kBoxSizeToEnd) {
+      return {buffer_len, true};
+    }
+    if (box_size == kBoxSizeLarge) {
+      if (buffer_len - pos < kBoxLargeHeaderSize) {
+        break;
+      }
+      box_size = ReadBigEndian<uint64_t>(&box[kBoxHeaderSize]);
+    }
+
+    if (box_size < kBoxHeaderSize) {
+      break;
+    }
+    if (box_size >= buffer_len - pos) {
+      return {buffer_len, true};
+    }
+    pos += static_cast<std::size_t>(box_size);
+  }
+
+  return {pos, true};
+}
+
+StreamExtent WalkASFObjects(const uint8_t* buffer, std::size_t buffer_len) {
+  // Top-level ASF objects: GUID (16 bytes) + uint64_t(object_size, LE)
+  constexpr std::size_t kGuidSize = 16;
+  using ASFGuid = std::array<uint8_t, kGuidSize>;
+  constexpr std::array<ASFGuid, 4> kTopLevelObjects = {{
+      // Header Object
+      {0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11, 0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C},
+      // Data Object
+      {0x36, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11, 0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C},
+      // Simple Index Object
+      {0x90, 0x08, 0x00, 0x33, 0xB1, 0xE5, 0xCF, 0x11, 0x89, 0xF4, 0x00, 0xA0, 0xC9, 0x03, 0x49, 0xCB},
+      // Index Object
+      {0xD3, 0x29, 0xE2, 0xD6, 0xDA, 0x35, 0xD1, 0x11, 0x90, 0x34, 0x00, 0xA0, 0xC9, 0x03, 0x49, 0xBE},
+  }};
+  constexpr std::size_t kObjectHeaderSize = kGuidSize + sizeof(uint64_t);
+  constexpr std::size_t kOffsetObjectSize = kGuidSize;
+
+  std::size_t pos = 0;
+  while (buffer_len - pos >= kObjectHeaderSize) {
+    const uint8_t* object = &buffer[pos];
+    const bool known_object = std::any_of(kTopLevelObjects.begin(), kTopLevelObjects.end(), [&](const ASFGuid& guid) {
+      return std::equal(guid.begin(), guid.end(), object);
+    });
+    const auto object_size = ReadLittleEndian<uint64_t>(&object[kOffsetObjectSize]);
+
+    // The first object must be the header object.
+    if (!known_object || (pos == 0 && !std::equal(kTopLevelObjects[0].begin(), kTopLevelObjects[0].end(), object)) ||
+        object_size < kObjectHeaderSize) {
+      break;
+    }
+    if (object_size >= buffer_len - pos) {
+      return {buffer_len, true};
+    }
+    pos += static_cast<std::size_t>(object_size);
+  }
+
+  return {pos, true};
+}
+
+StreamExtent ProbeFLAC(const uint8_t* buffer, std::size_t buffer_len) {
+  // "fLaC", then the mandatory STREAMINFO block: uint8_t(last_block << 7 | type=0) uint24_t(len=34)
+  constexpr std::size_t kMinFLACSize = 8;
+  constexpr std::size_t kOffsetStreamInfoHeader = 4;
+  constexpr uint32_t kBlockTypeMask = 0x7F00'0000;
+  constexpr uint32_t kBlockLengthMask = 0x00FF'FFFF;
+  constexpr uint32_t kStreamInfoLength = 34;
+
+  if (buffer_len < kMinFLACSize) {
+    return {};
+  }
+  const auto block_header = ReadBigEndian<uint32_t>(&buffer[kOffsetStreamInfoHeader]);
+  if ((block_header & kBlockTypeMask) != 0 || (block_header & kBlockLengthMask) != kStreamInfoLength) {
+    return {};
+  }
+  return {buffer_len, false};
+}
+
+StreamExtent ProbeAPE(const uint8_t* buffer, std::size_t buffer_len) {
+  // offset    value
+  //      0    header('MAC ')
+  //      4    uint16_t(version)
+  // Since 3.98 a descriptor follows:
+  //      8    uint32_t(descriptor_bytes), uint32_t(header_bytes), uint32_t(seek_table_bytes),
+  //           uint32_t(header_data_bytes), uint32_t(frame_data_bytes), uint32_t(frame_data_bytes_high),
+  //           uint32_t(terminating_data_bytes)
+  constexpr std::size_t kMinAPESize = 6;
+  constexpr std::size_t kAPEDescriptorSize = 0x24;
+  constexpr uint16_t kMinAPEVersion = 3800;
+  constexpr uint16_t kMaxAPEVersion = 4999;
+  constexpr uint16_t kAPEDescriptorVersion = 3980;
+  constexpr std::size_t kOffsetDescriptorBytes = 0x08;
+  constexpr std::size_t kOffsetFrameDataBytesHigh = 0x1C;
+  constexpr std::size_t kOffsetTerminatingDataBytes = 0x20;
+  constexpr uint32_t kHighHalfShift = 32;
+
+  if (buffer_len < kMinAPESize) {
+    return {};
+  }
+  const auto version = ReadLittleEndian<uint16_t>(&buffer[4]);
+  if (version < kMinAPEVersion || version > kMaxAPEVersion) {
+    return {};
+  }
+
+  if (version >= kAPEDescriptorVersion && buffer_len >= kAPEDescriptorSize) {
+    uint64_t total = 0;
+    for (std::size_t offset = kOffsetDescriptorBytes; offset <= kOffsetTerminatingDataBytes;
+         offset += sizeof(uint32_t)) {
+      const uint64_t bytes = ReadLittleEndian<uint32_t>(&buffer[offset]);
+      total += offset == kOffsetFrameDataBytesHigh ? bytes << kHighHalfShift : bytes;
+    }
+    if (total >= kAPEDescriptorSize) {
+      return {static_cast<std::size_t>(std::min<uint64_t>(total, buffer_len)), true};
+    }
+  }
+  return {buffer_len, false};
+}
+
+StreamExtent ProbeRIFFWave(const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr std::size_t kMinWAVSize = 12;
+  constexpr uint32_t kMagicWAVE = 0x57'41'56'45U;
+  constexpr std::size_t kRIFFHeaderSize = 8;
+  constexpr std::size_t kOffsetWAVE = 8;
+
+  if (buffer_len < kMinWAVSize || ReadBigEndian<uint32_t>(&buffer[kOffsetWAVE]) != kMagicWAVE) {
+    return {};
+  }
+  const uint64_t total = ReadLittleEndian<uint32_t>(&buffer[4]) + uint64_t{kRIFFHeaderSize};
+  return {static_cast<std::size_t>(std::min<uint64_t>(total, buffer_len)), true};
+}
+
+StreamExtent ProbeDSDIFF(const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr std::size_t kMinDFFSize = 16;
+  constexpr uint32_t kMagicDSD = 0x44'53'44'20U;
+  constexpr std::size_t kFRM8HeaderSize = 12;
+  constexpr std::size_t kOffsetDSD = 12;
+
+  if (buffer_len < kMinDFFSize || ReadBigEndian<uint32_t>(&buffer[kOffsetDSD]) != kMagicDSD) {
+    return {};
+  }
+  const auto chunk_size = ReadBigEndian<uint64_t>(&buffer[4]);
+  if (chunk_size >= buffer_len - kFRM8HeaderSize) {
+    return {buffer_len, true};
+  }
+  return {static_cast<std::size_t>(chunk_size) + kFRM8HeaderSize, true};
+}
+
+StreamExtent ProbeStream(const uint8_t* buffer, std::size_t buffer_len, AudioType type) {
+  switch (type) {
+    case AudioType::kAudioTypeMP3:
+      return WalkFrames(buffer, buffer_len, ParseMPEGAudioFrameHeader);
+    case AudioType::kAudioTypeAAC:
+      return WalkFrames(buffer, buffer_len, ParseADTSFrameHeader);
+    case AudioType::kAudioTypeOGG:
+      return WalkOggPages(buffer, buffer_len);
+    case AudioType::kAudioTypeM4A:
+    case AudioType::kAudioTypeM4B:
+    case AudioType::kAudioTypeMP4:
+      return WalkMP4Boxes(buffer, buffer_len);
+    case AudioType::kAudioTypeWMA:
+      return WalkASFObjects(buffer, buffer_len);
+    case AudioType::kAudioTypeFLAC:
+      return ProbeFLAC(buffer, buffer_len);
+    case AudioType::kAudioTypeAPE:
+      return ProbeAPE(buffer, buffer_len);
+    case AudioType::kAudioTypeWAV:
+      return ProbeRIFFWave(buffer, buffer_len);
+    case AudioType::kAudioTypeDFF:
+      return ProbeDSDIFF(buffer, buffer_len);
+
+    default:
+      return {};
+  }
+}
+
+std::optional<CarveHit> TryCarveAt(const uint8_t* buffer, std::size_t buffer_len, std::size_t offset) {
+  const uint8_t* stream = &buffer[offset];
+  const std::size_t stream_len = buffer_len - offset;
+
+  const auto type = DetectAudioType(stream, stream_len);
+  if (type == AudioType::kUnknownType) {
+    return std::nullopt;
+  }
+
+  // `DetectAudioType` has already checked the tag fits in the buffer.
+  const std::size_t tag_len = GetAudioHeaderMetadataSize(stream, stream_len);
+  const auto extent = ProbeStream(&stream[tag_len], stream_len - tag_len, type);
+  if (extent.length == 0) {
+    return std::nullopt;
+  }
+
+  return CarveHit{{offset, type, tag_len + extent.length}, extent.length_known};
+}
+
+std::vector<CarveHit> CarveRange(const uint8_t* buffer, std::size_t buffer_len, std::size_t begin, std::size_t end) {
+  constexpr std::size_t kOffsetFtypInBox = 4;
+
+  std::vector<CarveHit> hits;
+  std::size_t pos = begin;
+  while ((pos = FindNextCarveHit(buffer, pos, end)) < end) {
+    auto hit = TryCarveAt(buffer, buffer_len, pos);
+
+    // "ftyp" sits after the 4-byte box size, which has no fixed first byte to search for.
+    if (!hit && pos >= kOffsetFtypInBox && buffer_len - pos >= sizeof(uint32_t) &&
+        ReadBigEndian<uint32_t>(&buffer[pos]) == kMagic_ftyp) {
+      hit = TryCarveAt(buffer, buffer_len, pos - kOffsetFtypInBox);
+    }
+
+    if (!hit) {
+      pos++;
+      continue;
+    }
+
+    hits.push_back(*hit);
+    const auto& candidate = hit->candidate;
+    pos = hit->length_known ? std::max(pos + 1, candidate.offset + candidate.estimated_len) : pos + 1;
+  }
+  return hits;
+}
+
+}  // namespace
+
+std::vector<AudioCarveCandidate> CarveAudioStreams(const uint8_t* buffer,
+                                                   std::size_t buffer_len,
+                                                   std::size_t thread_count) {
+  const std::size_t max_chunks = std::max<std::size_t>(1, buffer_len / kMinCarveChunkSize);
+  const std::size_t chunk_count = std::clamp<std::size_t>(thread_count, 1, max_chunks);
+  const std::size_t chunk_size = (buffer_len + chunk_count - 1) / std::max<std::size_t>(chunk_count, 1);
+
+  std::vector<std::vector<CarveHit>> chunk_hits(chunk_count);
+  if (chunk_count == 1) {
+    chunk_hits[0] = CarveRange(buffer, buffer_len, 0, buffer_len);
+  } else {
+    std::vector<std::thread> workers;
+    workers.reserve(chunk_count);
+    for (std::size_t i = 0; i < chunk_count; i++) {
+      workers.emplace_back([&, i]() {
+        const std::size_t begin = i * chunk_size;
+        const std::size_t end = std::min(begin + chunk_size, buffer_len);
+        chunk_hits[i] = CarveRange(buffer, buffer_len, begin, end);
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  // Stitch chunks together as if scanned sequentially. A stream accepted in one chunk may run into the
+  // next, whose own scan started in the middle of it: hits inside the stream are dropped, and if that
+  // scan was itself skipping over a (bogus) stream when it crossed the real stream's end, the rest of
+  // the chunk is scanned again from there.
+  std::vector<CarveHit> hits;
+  std::size_t covered_end = 0;
+  for (std::size_t i = 0; i < chunk_count; i++) {
+    const std::size_t begin = i * chunk_size;
+    const std::size_t end = std::min(begin + chunk_size, buffer_len);
+    if (covered_end >= end) {
+      continue;
+    }
+
+    auto& current = chunk_hits[i];
+    if (covered_end > begin) {
+      const bool in_sync = std::none_of(current.begin(), current.end(), [&](const CarveHit& hit) {
+        return hit.length_known && hit.candidate.offset < covered_end &&
+               covered_end < hit.candidate.offset + hit.candidate.estimated_len;
+      });
+      if (!in_sync) {
+        current = CarveRange(buffer, buffer_len, covered_end, end);
+      }
+    }
+
+    for (const auto& hit : current) {
+      if (hit.candidate.offset < covered_end) {
+        continue;
+      }
+      hits.push_back(hit);
+      if (hit.length_known) {
+        covered_end = std::max(covered_end, hit.candidate.offset + hit.candidate.estimated_len);
+      }
+    }
+  }
+
+  std::stable_sort(hits.begin(), hits.end(), [](const CarveHit& lhs, const CarveHit& rhs) {
+    return lhs.candidate.offset < rhs.candidate.offset;
+  });
+
+  std::vector<AudioCarveCandidate> result;
+  result.reserve(hits.size());
+  for (std::size_t i = 0; i < hits.size(); i++) {
+    auto candidate = hits[i].candidate;
+    if (!hits[i].length_known) {
+      const std::size_t next_offset = i + 1 < hits.size() ? hits[i + 1].candidate.offset : buffer_len;
+      candidate.estimated_len = next_offset - candidate.offset;
+    }
+    result.push_back(candidate);
+  }
+  return result;
+}
+
+}  // namespace parakeet_audio
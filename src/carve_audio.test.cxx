@@ -0,0 +1,126 @@
+#include "parakeet-audio/carve_audio.h"
+
+#include "audio_test_data.test.hh"
+#include "parakeet_endian.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using parakeet_audio::AudioCarveCandidate;
+using parakeet_audio::AudioType;
+using parakeet_audio::CarveAudioStreams;
+using parakeet_audio::test::FillNoise;
+using parakeet_audio::test::kMP3FrameSize;
+using parakeet_audio::test::WriteMP3Frames;
+using parakeet_audio::test::WriteOggPage;
+
+TEST(AudioCarving, FindsStreamsAtUnknownOffsets) {
+  std::vector<uint8_t> buffer(0x4000);
+
+  // WAV, 0x100 bytes in total.
+  std::copy_n("RIFF", 4, &buffer[0x123]);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&buffer[0x127], 0xF8);
+  std::copy_n("WAVE", 4, &buffer[0x12B]);
+
+  // MP3, 4 frames.
+  WriteMP3Frames(&buffer[0x501], 4);
+
+  // Ogg, 2 pages; the second page must not be reported on its own.
+  std::size_t ogg_len = WriteOggPage(&buffer[0x1003], 1, 100);
+  ogg_len += WriteOggPage(&buffer[0x1003 + ogg_len], 1, 200);
+
+  // FLAC has no length of its own, so it extends to the end of buffer.
+  std::copy_n("fLaC", 4, &buffer[0x2000]);
+  buffer[0x2004] = 0x80;
+  buffer[0x2007] = 34;
+
+  auto candidates = CarveAudioStreams(buffer.data(), buffer.size());
+  ASSERT_EQ(candidates.size(), 4);
+
+  EXPECT_EQ(candidates[0].offset, 0x123);
+  EXPECT_EQ(candidates[0].type, AudioType::kAudioTypeWAV);
+  EXPECT_EQ(candidates[0].estimated_len, 0x100);
+
+  EXPECT_EQ(candidates[1].offset, 0x501);
+  EXPECT_EQ(candidates[1].type, AudioType::kAudioTypeMP3);
+  EXPECT_EQ(candidates[1].estimated_len, 4 * kMP3FrameSize);
+
+  EXPECT_EQ(candidates[2].offset, 0x1003);
+  EXPECT_EQ(candidates[2].type, AudioType::kAudioTypeOGG);
+  EXPECT_EQ(candidates[2].estimated_len, ogg_len);
+
+  EXPECT_EQ(candidates[3].offset, 0x2000);
+  EXPECT_EQ(candidates[3].type, AudioType::kAudioTypeFLAC);
+  EXPECT_EQ(candidates[3].estimated_len, buffer.size() - 0x2000);
+}
+
+TEST(AudioCarving, MP4AndID3TaggedMP3) {
+  std::vector<uint8_t> buffer(0x1000);
+
+  // ftyp (0x18) + mdat (0x20)
+  parakeet_audio::WriteBigEndian<uint32_t>(&buffer[0x10], 0x18);
+  std::copy_n("ftypM4A ", 8, &buffer[0x14]);
+  parakeet_audio::WriteBigEndian<uint32_t>(&buffer[0x28], 0x20);
+  std::copy_n("mdat", 4, &buffer[0x2C]);
+
+  // ID3v2 tag of 0x20 bytes, followed by 3 frames.
+  std::array<uint8_t, 10> id3 = {'I', 'D', '3', 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16};
+  std::copy(id3.begin(), id3.end(), &buffer[0x200]);
+  WriteMP3Frames(&buffer[0x220], 3);
+
+  auto candidates = CarveAudioStreams(buffer.data(), buffer.size());
+  ASSERT_EQ(candidates.size(), 2);
+
+  EXPECT_EQ(candidates[0].offset, 0x10);
+  EXPECT_EQ(candidates[0].type, AudioType::kAudioTypeM4A);
+  EXPECT_EQ(candidates[0].estimated_len, 0x38);
+
+  EXPECT_EQ(candidates[1].offset, 0x200);
+  EXPECT_EQ(candidates[1].type, AudioType::kAudioTypeMP3);
+  EXPECT_EQ(candidates[1].estimated_len, 0x20 + 3 * kMP3FrameSize);
+}
+
+TEST(AudioCarving, IgnoresLoneFrameSync) {
+  std::vector<uint8_t> buffer(0x1000);
+  WriteMP3Frames(&buffer[0x100], 2);
+
+  auto candidates = CarveAudioStreams(buffer.data(), buffer.size());
+  EXPECT_TRUE(candidates.empty());
+}
+
+TEST(AudioCarving, ThreadedScanMatchesSequential) {
+  constexpr std::size_t kMiB = 1024 * 1024;
+  std::vector<uint8_t> buffer(4 * kMiB + 123);
+  FillNoise(buffer.data(), buffer.size(), 0x12345678);
+
+  // Streams spanning chunk boundaries.
+  WriteMP3Frames(&buffer[kMiB - 1000], 10);
+  std::copy_n("RIFF", 4, &buffer[2 * kMiB - 8]);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&buffer[2 * kMiB - 4], 0x10000);
+  std::copy_n("WAVE", 4, &buffer[2 * kMiB]);
+
+  auto sequential = CarveAudioStreams(buffer.data(), buffer.size(), 1);
+  auto threaded = CarveAudioStreams(buffer.data(), buffer.size(), 4);
+
+  ASSERT_EQ(sequential.size(), threaded.size());
+  for (std::size_t i = 0; i < sequential.size(); i++) {
+    EXPECT_EQ(sequential[i].offset, threaded[i].offset);
+    EXPECT_EQ(sequential[i].type, threaded[i].type);
+    EXPECT_EQ(sequential[i].estimated_len, threaded[i].estimated_len);
+  }
+
+  auto has_candidate = [&](std::size_t offset, AudioType type) {
+    return std::any_of(sequential.begin(), sequential.end(), [&](const AudioCarveCandidate& candidate) {
+      return candidate.offset == offset && candidate.type == type;
+    });
+  };
+  EXPECT_TRUE(has_candidate(kMiB - 1000, AudioType::kAudioTypeMP3));
+  EXPECT_TRUE(has_candidate(2 * kMiB - 8, AudioType::kAudioTypeWAV));
+}
@@ -0,0 +1,402 @@
+#include "parakeet-audio/extract_adts.h"
+#include "mp4_box.h"
+#include "parakeet_endian.h"
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace parakeet_audio {
+
+namespace {
+
+constexpr uint32_t kMaxADTSFrameSize = (1 << 13) - 1;
+
+constexpr std::array<uint32_t, 13> kAACSampleRateTable = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350,
+};
+
+struct AACConfig {
+  uint32_t profile;  // ADTS profile: audio object type - 1
+  uint32_t sample_rate_index;
+  uint32_t channels;
+};
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* buffer, std::size_t buffer_len) : buffer_(buffer), bits_left_(buffer_len * CHAR_BIT) {}
+
+  [[nodiscard]] bool HasBits(std::size_t count) const { return count <= bits_left_; }
+
+  // Caller checks `HasBits` first.
+  uint32_t Read(std::size_t count) {
+    constexpr std::size_t kMaxBitIndex = CHAR_BIT - 1;
+
+    uint32_t value = 0;
+    for (std::size_t i = 0; i < count; i++, pos_++, bits_left_--) {
+      value = (value << 1) | ((buffer_[pos_ / CHAR_BIT] >> (kMaxBitIndex - pos_ % CHAR_BIT)) & 1);
+    }
+    return value;
+  }
+
+ private:
+  const uint8_t* buffer_;
+  std::size_t pos_ = 0;
+  std::size_t bits_left_;
+};
+
+/**
+ * @brief Parse AudioSpecificConfig (ISO/IEC 14496-3 1.6.2.1) into what ADTS can express.
+ * @return AACConfig with `channels` 0 if not representable in ADTS.
+ */
+AACConfig ParseAudioSpecificConfig(const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr std::size_t kAOTBits = 5;
+  constexpr std::size_t kAOTExtBits = 6;
+  constexpr uint32_t kAOTEscape = 31;
+  constexpr uint32_t kAOTSBR = 5;
+  constexpr uint32_t kAOTPS = 29;
+  constexpr uint32_t kMaxADTSAOT = 4;  // AAC Main, LC, SSR, LTP
+  constexpr uint32_t kSampleRateIndexExplicit = 15;
+  constexpr uint32_t kMaxChannelConfig = 7;
+
+  BitReader reader(buffer, buffer_len);
+  auto read_object_type = [&]() -> uint32_t {
+    if (!reader.HasBits(kAOTBits)) {
+      return 0;
+    }
+    const uint32_t object_type = reader.Read(kAOTBits);
+    if (object_type != kAOTEscape) {
+      return object_type;
+    }
+    return reader.HasBits(kAOTExtBits) ? kAOTEscape + 1 + reader.Read(kAOTExtBits) : 0;
+  };
+
+  uint32_t object_type = read_object_type();
+  if (!reader.HasBits(4 + 4)) {
+    return {};
+  }
+  const uint32_t sample_rate_index = reader.Read(4);
+  if (sample_rate_index == kSampleRateIndexExplicit || sample_rate_index >= kAACSampleRateTable.size()) {
+    return {};
+  }
+  const uint32_t channels = reader.Read(4);
+
+  // HE-AAC (v2) with explicit signalling: ADTS carries the core AAC stream, SBR/PS is implicit.
+  if (object_type == kAOTSBR || object_type == kAOTPS) {
+    if (!reader.HasBits(4) || reader.Read(4) == kSampleRateIndexExplicit) {
+      return {};
+    }
+    object_type = read_object_type();
+  }
+
+  if (object_type == 0 || object_type > kMaxADTSAOT || channels == 0 || channels > kMaxChannelConfig) {
+    return {};
+  }
+  return {object_type - 1, sample_rate_index, channels};
+}
+
+/**
+ * @brief Read an expandable-size descriptor header (ISO/IEC 14496-1 8.3.3).
+ * @return std::size_t header length, 0 if invalid. `payload_len` is checked against `buffer_len`.
+ */
+std::size_t ReadDescriptorHeader(const uint8_t* buffer,
+                                 std::size_t buffer_len,
+                                 uint8_t& tag,
+                                 std::size_t& payload_len) {
+  constexpr std::size_t kMaxSizeBytes = 4;
+  constexpr std::size_t kSizeBitsPerByte = 7;
+  constexpr uint8_t kSizeValueMask = 0x7F;
+  constexpr uint8_t kSizeNextByteFlag = 0x80;
+
+  if (buffer_len < 2) {
+    return 0;
+  }
+  tag = buffer[0];
+  payload_len = 0;
+  for (std::size_t i = 1; i <= kMaxSizeBytes && i < buffer_len; i++) {
+    payload_len = (payload_len << kSizeBitsPerByte) | (buffer[i] & kSizeValueMask);
+    if ((buffer[i] & kSizeNextByteFlag) == 0) {
+      const std::size_t header_len = i + 1;
+      return payload_len <= buffer_len - header_len ? header_len : 0;
+    }
+  }
+  return 0;
+}
+
+AACConfig ParseESDS(const uint8_t* buffer, std::size_t buffer_len) {
+  // esds: uint32_t(version_flags), ES_Descriptor {
+  //   uint16_t(es_id) uint8_t(flags) [optional fields by flags]
+  //   DecoderConfigDescriptor {
+  //     uint8_t(object_type) uint8_t(stream_type) uint24_t(buffer_size) uint32_t(max_br) uint32_t(avg_br)
+  //     DecoderSpecificInfo { AudioSpecificConfig }
+  //   }
+  // }
+  constexpr uint8_t kTagESDescriptor = 0x03;
+  constexpr uint8_t kTagDecoderConfig = 0x04;
+  constexpr uint8_t kTagDecoderSpecificInfo = 0x05;
+  constexpr uint8_t kObjectTypeMPEG4Audio = 0x40;
+  constexpr uint8_t kObjectTypeMPEG2AACMain = 0x66;
+  constexpr uint8_t kObjectTypeMPEG2AACSSR = 0x68;
+  constexpr std::size_t kFullBoxHeaderSize = 4;
+  constexpr std::size_t kDecoderConfigFixedSize = 13;
+  constexpr uint8_t kESDescStreamDependenceFlag = 0x80;
+  constexpr uint8_t kESDescURLFlag = 0x40;
+  constexpr uint8_t kESDescOCRStreamFlag = 0x20;
+
+  if (buffer_len < kFullBoxHeaderSize) {
+    return {};
+  }
+  std::size_t pos = kFullBoxHeaderSize;
+  uint8_t tag = 0;
+  std::size_t payload_len = 0;
+
+  // ES_Descriptor
+  std::size_t header_len = ReadDescriptorHeader(&buffer[pos], buffer_len - pos, tag, payload_len);
+  constexpr std::size_t kESFixedSize = 3;
+  if (header_len == 0 || tag != kTagESDescriptor || payload_len < kESFixedSize) {
+    return {};
+  }
+  pos += header_len;
+  const std::size_t es_end = pos + payload_len;
+  const uint8_t es_flags = buffer[pos + 2];
+  pos += kESFixedSize;
+  if ((es_flags & kESDescStreamDependenceFlag) != 0) {
+    pos += 2;  // depends_on_es_id
+  }
+  if ((es_flags & kESDescURLFlag) != 0) {
+    pos += pos < es_end ? 1 + buffer[pos] : 1;  // url
+  }
+  if ((es_flags & kESDescOCRStreamFlag) != 0) {
+    pos += 2;  // ocr_es_id
+  }
+  if (pos >= es_end) {
+    return {};
+  }
+
+  // DecoderConfigDescriptor
+  header_len = ReadDescriptorHeader(&buffer[pos], es_end - pos, tag, payload_len);
+  if (header_len == 0 || tag != kTagDecoderConfig || payload_len < kDecoderConfigFixedSize) {
+    return {};
+  }
+  pos += header_len;
+  const std::size_t config_end = pos + payload_len;
+  const uint8_t object_type = buffer[pos];
+  if (object_type != kObjectTypeMPEG4Audio &&
+      (object_type < kObjectTypeMPEG2AACMain || object_type > kObjectTypeMPEG2AACSSR)) {
+    return {};
+  }
+  pos += kDecoderConfigFixedSize;
+
+  // DecoderSpecificInfo
+  header_len = ReadDescriptorHeader(&buffer[pos], config_end - pos, tag, payload_len);
+  if (header_len == 0 || tag != kTagDecoderSpecificInfo) {
+    return {};
+  }
+  return ParseAudioSpecificConfig(&buffer[pos + header_len], payload_len);
+}
+
+AACConfig ParseMP4AudioSampleEntry(const MP4Box& entry) {
+  // SampleEntry: byte[6](reserved) uint16_t(data_reference_index)
+  // AudioSampleEntry: uint16_t(version) ... 20 bytes in total for version 0,
+  //                   QuickTime sound description version 1/2 adds 16/36 bytes.
+  // Then child boxes: esds, or wave/esds for QuickTime.
+  constexpr std::size_t kAudioSampleEntrySize = 28;
+  constexpr std::array<std::size_t, 3> kVersionExtraSize = {0, 16, 36};
+  constexpr std::size_t kOffsetVersion = 8;
+
+  if (entry.type != MP4BoxType("mp4a") || entry.payload_len < kAudioSampleEntrySize) {
+    return {};
+  }
+  const auto version = ReadBigEndian<uint16_t>(&entry.payload[kOffsetVersion]);
+  if (version >= kVersionExtraSize.size() || entry.payload_len < kAudioSampleEntrySize + kVersionExtraSize[version]) {
+    return {};
+  }
+
+  const std::size_t children_offset = kAudioSampleEntrySize + kVersionExtraSize[version];
+  const uint8_t* children = &entry.payload[children_offset];
+  const std::size_t children_len = entry.payload_len - children_offset;
+
+  auto esds = FindMP4Box(children, children_len, MP4BoxType("esds"));
+  if (esds.payload == nullptr) {
+    const auto wave = FindMP4Box(children, children_len, MP4BoxType("wave"));
+    if (wave.payload == nullptr) {
+      return {};
+    }
+    esds = FindMP4Box(wave.payload, wave.payload_len, MP4BoxType("esds"));
+    if (esds.payload == nullptr) {
+      return {};
+    }
+  }
+  return ParseESDS(esds.payload, esds.payload_len);
+}
+
+/**
+ * @brief Resolve `stsz`, `stsc` and `stco`/`co64` into one absolute range per sample.
+ * @return false if the tables are inconsistent, or point outside of the buffer.
+ */
+bool ReadSampleTable(const MP4Box& stbl, std::size_t buffer_len, std::vector<ADTSSampleRange>& samples) {
+  constexpr std::size_t kFullBoxHeaderSize = 4;
+  constexpr std::size_t kStszHeaderSize = kFullBoxHeaderSize + 8;
+  constexpr std::size_t kTableHeaderSize = kFullBoxHeaderSize + 4;
+  constexpr std::size_t kStscEntrySize = 12;
+  constexpr std::size_t kOffsetTableEntryCount = 4;
+  constexpr std::size_t kOffsetStszSampleCount = 8;
+
+  const auto stsz = FindMP4Box(stbl.payload, stbl.payload_len, MP4BoxType("stsz"));
+  const auto stsc = FindMP4Box(stbl.payload, stbl.payload_len, MP4BoxType("stsc"));
+  auto chunk_offsets = FindMP4Box(stbl.payload, stbl.payload_len, MP4BoxType("stco"));
+  std::size_t chunk_offset_size = sizeof(uint32_t);
+  if (chunk_offsets.payload == nullptr) {
+    chunk_offsets = FindMP4Box(stbl.payload, stbl.payload_len, MP4BoxType("co64"));
+    chunk_offset_size = sizeof(uint64_t);
+  }
+  if (stsz.payload == nullptr || stsc.payload == nullptr || chunk_offsets.payload == nullptr ||
+      stsz.payload_len < kStszHeaderSize || stsc.payload_len < kTableHeaderSize ||
+      chunk_offsets.payload_len < kTableHeaderSize) {
+    return false;
+  }
+
+  // stsz: uint32_t(version_flags) uint32_t(sample_size) uint32_t(sample_count) [uint32_t[sample_count]]
+  const uint32_t fixed_sample_size = ReadBigEndian<uint32_t>(&stsz.payload[kOffsetTableEntryCount]);
+  const std::size_t sample_count = ReadBigEndian<uint32_t>(&stsz.payload[kOffsetStszSampleCount]);
+  if (fixed_sample_size == 0 && (stsz.payload_len - kStszHeaderSize) / sizeof(uint32_t) < sample_count) {
+    return false;
+  }
+  // A fixed size has no table to bound the count: samples must fit in the buffer before we reserve them.
+  if (fixed_sample_size != 0 && static_cast<uint64_t>(sample_count) * fixed_sample_size > buffer_len) {
+    return false;
+  }
+
+  // stsc: uint32_t(version_flags) uint32_t(entry_count) {first_chunk, samples_per_chunk, description_index}[]
+  const std::size_t stsc_count = ReadBigEndian<uint32_t>(&stsc.payload[kOffsetTableEntryCount]);
+  // stco/co64: uint32_t(version_flags) uint32_t(entry_count) uint32_t/uint64_t[entry_count]
+  const std::size_t chunk_count = ReadBigEndian<uint32_t>(&chunk_offsets.payload[kOffsetTableEntryCount]);
+  if ((stsc.payload_len - kTableHeaderSize) / kStscEntrySize < stsc_count ||
+      (chunk_offsets.payload_len - kTableHeaderSize) / chunk_offset_size < chunk_count) {
+    return false;
+  }
+
+  samples.clear();
+  samples.reserve(sample_count);
+  for (std::size_t i = 0; i < stsc_count && samples.size() < sample_count; i++) {
+    const uint8_t* entry = &stsc.payload[kTableHeaderSize + i * kStscEntrySize];
+    const std::size_t first_chunk = ReadBigEndian<uint32_t>(entry);
+    const std::size_t samples_per_chunk = ReadBigEndian<uint32_t>(&entry[4]);
+    const std::size_t next_first_chunk =
+        i + 1 < stsc_count ? ReadBigEndian<uint32_t>(&entry[kStscEntrySize]) : chunk_count + 1;
+    if (first_chunk == 0 || next_first_chunk < first_chunk || next_first_chunk > chunk_count + 1) {
+      return false;
+    }
+
+    for (std::size_t chunk = first_chunk; chunk < next_first_chunk && samples.size() < sample_count; chunk++) {
+      const uint8_t* chunk_entry = &chunk_offsets.payload[kTableHeaderSize + (chunk - 1) * chunk_offset_size];
+      uint64_t offset = chunk_offset_size == sizeof(uint64_t) ? ReadBigEndian<uint64_t>(chunk_entry)
+                                                              : ReadBigEndian<uint32_t>(chunk_entry);
+
+      for (std::size_t j = 0; j < samples_per_chunk && samples.size() < sample_count; j++) {
+        const uint32_t size = fixed_sample_size != 0
+                                  ? fixed_sample_size
+                                  : ReadBigEndian<uint32_t>(&stsz.payload[kStszHeaderSize + samples.size() * 4]);
+        if (size > kMaxADTSFrameSize - kADTSHeaderSize || offset > buffer_len || size > buffer_len - offset) {
+          return false;
+        }
+        samples.push_back({offset, size});
+        offset += size;
+      }
+    }
+  }
+
+  return samples.size() == sample_count;
+}
+
+void WriteADTSHeader(uint8_t* header, const AACConfig& config, std::size_t frame_size) {
+  // AAAAAAAA AAAABCCD EEFFFFGH HHIJKLMM MMMMMMMM MMMOOOOO OOOOOOPP
+  //   MPEG-4, layer 0, no CRC; buffer fullness 0x7FF (VBR), 1 raw data block.
+  constexpr uint32_t kBufferFullnessVBR = 0x7FF;
+  constexpr uint8_t kADTSSyncByte0 = 0xFF;
+  constexpr uint8_t kADTSSyncByte1MPEG4NoCRC = 0xF1;
+  constexpr uint32_t kProfileShift = 6;
+  constexpr uint32_t kSampleRateIndexShift = 2;
+  constexpr uint32_t kChannelsHighShift = 2;
+  constexpr uint32_t kChannelsLowMask = 0b11;
+  constexpr uint32_t kChannelsLowShift = 6;
+  constexpr std::size_t kFrameSizeHighShift = 11;
+  constexpr std::size_t kFrameSizeMidShift = 3;
+  constexpr std::size_t kFrameSizeLowMask = 0b111;
+  constexpr std::size_t kFrameSizeLowShift = 5;
+  constexpr uint32_t kBufferFullnessHighShift = 6;
+  constexpr uint32_t kBufferFullnessLowMask = 0b11'1111;
+  constexpr uint32_t kBufferFullnessLowShift = 2;
+
+  header[0] = kADTSSyncByte0;
+  header[1] = kADTSSyncByte1MPEG4NoCRC;
+  header[2] = static_cast<uint8_t>((config.profile << kProfileShift) |
+                                   (config.sample_rate_index << kSampleRateIndexShift) |
+                                   (config.channels >> kChannelsHighShift));
+  header[3] = static_cast<uint8_t>(((config.channels & kChannelsLowMask) << kChannelsLowShift) |
+                                   (frame_size >> kFrameSizeHighShift));
+  header[4] = static_cast<uint8_t>(frame_size >> kFrameSizeMidShift);
+  header[5] = static_cast<uint8_t>(((frame_size & kFrameSizeLowMask) << kFrameSizeLowShift) |
+                                   (kBufferFullnessVBR >> kBufferFullnessHighShift));
+  header[6] = static_cast<uint8_t>((kBufferFullnessVBR & kBufferFullnessLowMask) << kBufferFullnessLowShift);
+}
+
+}  // namespace
+
+ADTSStreamPlan PlanADTSStreamFromMP4(const uint8_t* buffer, std::size_t buffer_len) {
+  ADTSStreamPlan plan{};
+
+  const auto moov = FindMP4Box(buffer, buffer_len, MP4BoxType("moov"));
+  if (moov.payload == nullptr) {
+    return plan;
+  }
+
+  ForEachMP4Box(moov.payload, moov.payload_len, [&](const MP4Box& trak) {
+    if (trak.type != MP4BoxType("trak")) {
+      return true;
+    }
+
+    // hdlr: uint32_t(version_flags) uint32_t(pre_defined) uint32_t(handler_type) ...
+    constexpr std::size_t kOffsetHandlerType = 8;
+    const auto mdia = FindMP4Box(trak.payload, trak.payload_len, MP4BoxType("mdia"));
+    const auto hdlr = FindMP4Box(mdia.payload, mdia.payload_len, MP4BoxType("hdlr"));
+    if (hdlr.payload_len < kOffsetHandlerType + 4 ||
+        ReadBigEndian<uint32_t>(&hdlr.payload[kOffsetHandlerType]) != MP4BoxType("soun")) {
+      return true;
+    }
+
+    // stsd: uint32_t(version_flags) uint32_t(entry_count) SampleEntry[]
+    constexpr std::size_t kStsdHeaderSize = 8;
+    const auto minf = FindMP4Box(mdia.payload, mdia.payload_len, MP4BoxType("minf"));
+    const auto stbl = FindMP4Box(minf.payload, minf.payload_len, MP4BoxType("stbl"));
+    const auto stsd = FindMP4Box(stbl.payload, stbl.payload_len, MP4BoxType("stsd"));
+    if (stsd.payload_len < kStsdHeaderSize) {
+      return true;
+    }
+
+    MP4Box entry{};
+    ForEachMP4Box(&stsd.payload[kStsdHeaderSize], stsd.payload_len - kStsdHeaderSize, [&](const MP4Box& box) {
+      entry = box;
+      return false;
+    });
+    const auto config = ParseMP4AudioSampleEntry(entry);
+    if (config.channels == 0 || !ReadSampleTable(stbl, buffer_len, plan.samples)) {
+      plan.samples.clear();
+      return true;
+    }
+
+    plan.sample_rate = kAACSampleRateTable[config.sample_rate_index];
+    plan.channels = config.channels;
+    plan.headers.resize(plan.samples.size() * kADTSHeaderSize);
+    for (std::size_t i = 0; i < plan.samples.size(); i++) {
+      WriteADTSHeader(&plan.headers[i * kADTSHeaderSize], config, plan.samples[i].size + kADTSHeaderSize);
+    }
+    return false;
+  });
+
+  return plan;
+}
+
+}  // namespace parakeet_audio
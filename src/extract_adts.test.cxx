@@ -0,0 +1,168 @@
+#include "parakeet-audio/extract_adts.h"
+
+#include "audio_frame_header.h"
+#include "audio_test_data.test.hh"
+#include "parakeet_endian.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+using parakeet_audio::ADTSIOVec;
+using parakeet_audio::GetADTSStreamIOVecs;
+using parakeet_audio::kADTSHeaderSize;
+using parakeet_audio::PlanADTSStreamFromMP4;
+using parakeet_audio::test::Box;
+using parakeet_audio::test::U32BE;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+Bytes Concat(std::initializer_list<Bytes> parts) {
+  Bytes result;
+  for (const auto& part : parts) {
+    result.insert(result.end(), part.begin(), part.end());
+  }
+  return result;
+}
+
+Bytes MakeESDS(const Bytes& audio_specific_config) {
+  const auto asc_len = static_cast<uint8_t>(audio_specific_config.size());
+  Bytes decoder_config = {0x04, static_cast<uint8_t>(13 + 2 + asc_len), 0x40, 0x15};
+  decoder_config.resize(decoder_config.size() + 11);
+  decoder_config.push_back(0x05);
+  decoder_config.push_back(asc_len);
+  decoder_config.insert(decoder_config.end(), audio_specific_config.begin(), audio_specific_config.end());
+
+  // ES_Descriptor uses the 4-byte size form, as written by most muxers.
+  const auto es_len = static_cast<uint8_t>(3 + decoder_config.size());
+  Bytes es = {0x03, 0x80, 0x80, 0x80, es_len, 0x00, 0x01, 0x00};
+  return Box("esds", Concat({U32BE(0), es, decoder_config}));
+}
+
+// Build a M4A with `sample_sizes` samples, grouped 2 per chunk, in a mdat placed after moov.
+Bytes MakeM4A(const std::vector<uint32_t>& sample_sizes, const Bytes& audio_specific_config) {
+  Bytes mp4a_body(28);
+  parakeet_audio::WriteBigEndian<uint16_t>(&mp4a_body[6], 1);    // data_reference_index
+  parakeet_audio::WriteBigEndian<uint16_t>(&mp4a_body[16], 2);   // channels
+  parakeet_audio::WriteBigEndian<uint16_t>(&mp4a_body[18], 16);  // sample size
+  parakeet_audio::WriteBigEndian<uint32_t>(&mp4a_body[24], 44100U << 16);
+  const Bytes mp4a = Box("mp4a", Concat({mp4a_body, MakeESDS(audio_specific_config)}));
+  const Bytes stsd = Box("stsd", Concat({U32BE(0), U32BE(1), mp4a}));
+
+  Bytes stsz_body = Concat({U32BE(0), U32BE(0), U32BE(static_cast<uint32_t>(sample_sizes.size()))});
+  for (auto size : sample_sizes) {
+    stsz_body = Concat({stsz_body, U32BE(size)});
+  }
+  const Bytes stsc = Box("stsc", Concat({U32BE(0), U32BE(1), U32BE(1), U32BE(2), U32BE(1)}));
+  const std::size_t chunk_count = (sample_sizes.size() + 1) / 2;
+
+  auto build = [&](uint32_t mdat_payload_offset) {
+    Bytes stco_body = Concat({U32BE(0), U32BE(static_cast<uint32_t>(chunk_count))});
+    uint32_t offset = mdat_payload_offset;
+    for (std::size_t i = 0; i < sample_sizes.size(); i++) {
+      if (i % 2 == 0) {
+        stco_body = Concat({stco_body, U32BE(offset)});
+      }
+      offset += sample_sizes[i];
+    }
+
+    const Bytes hdlr =
+        Box("hdlr", Concat({U32BE(0), U32BE(0), {'s', 'o', 'u', 'n'}, U32BE(0), U32BE(0), U32BE(0), {0}}));
+    const Bytes stbl = Box("stbl", Concat({stsd, Box("stsz", stsz_body), stsc, Box("stco", stco_body)}));
+    const Bytes trak = Box("trak", Box("mdia", Concat({hdlr, Box("minf", stbl)})));
+    return Concat({Box("ftyp", {'M', '4', 'A', ' ', 0, 0, 0, 0}), Box("moov", trak)});
+  };
+
+  // Layout does not depend on the offsets, so build twice to fix them up.
+  const auto head_len = static_cast<uint32_t>(build(0).size());
+  Bytes file = build(head_len + 8);
+
+  Bytes mdat_payload;
+  for (std::size_t i = 0; i < sample_sizes.size(); i++) {
+    mdat_payload.insert(mdat_payload.end(), sample_sizes[i], static_cast<uint8_t>(i + 1));
+  }
+  return Concat({file, Box("mdat", mdat_payload)});
+}
+
+}  // namespace
+
+TEST(ExtractADTS, AACLowComplexity) {
+  // AAC-LC, 44.1kHz, stereo
+  const std::vector<uint32_t> sample_sizes = {100, 200, 150, 300, 50};
+  auto file = MakeM4A(sample_sizes, {0x12, 0x10});
+
+  auto plan = PlanADTSStreamFromMP4(file.data(), file.size());
+  ASSERT_EQ(plan.samples.size(), sample_sizes.size());
+  EXPECT_EQ(plan.sample_rate, 44100);
+  EXPECT_EQ(plan.channels, 2);
+  EXPECT_EQ(plan.headers.size(), sample_sizes.size() * kADTSHeaderSize);
+
+  // Concatenate the iovecs, as `writev` would, and walk the resulting ADTS stream.
+  Bytes stream;
+  for (const ADTSIOVec& iovec : GetADTSStreamIOVecs(plan, file.data())) {
+    const auto* base = static_cast<const uint8_t*>(iovec.base);
+    stream.insert(stream.end(), base, base + iovec.len);
+  }
+  EXPECT_EQ(stream.size(), plan.GetStreamSize());
+
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < sample_sizes.size(); i++) {
+    auto info = parakeet_audio::ParseADTSFrameHeader(&stream[pos], stream.size() - pos);
+    ASSERT_EQ(info.frame_size, sample_sizes[i] + kADTSHeaderSize);
+    EXPECT_EQ(info.sample_rate, 44100);
+    EXPECT_EQ(stream[pos + 2] >> 6, 1);  // profile: LC
+    EXPECT_EQ(stream[pos + kADTSHeaderSize], i + 1);
+    pos += info.frame_size;
+  }
+  EXPECT_EQ(pos, stream.size());
+}
+
+TEST(ExtractADTS, HEAACUsesCoreConfig) {
+  // HE-AAC (SBR) explicit: AOT 5, 24kHz core, stereo, 48kHz extension, then AOT 2.
+  auto file = MakeM4A({100, 100}, {0x2B, 0x11, 0x88, 0x00});
+
+  auto plan = PlanADTSStreamFromMP4(file.data(), file.size());
+  ASSERT_EQ(plan.samples.size(), 2);
+  EXPECT_EQ(plan.sample_rate, 24000);
+  EXPECT_EQ(plan.headers[2] >> 6, 1);  // profile: LC
+}
+
+TEST(ExtractADTSSadPath, SamplesOutsideBuffer) {
+  auto file = MakeM4A({100, 200}, {0x12, 0x10});
+  file.resize(file.size() - 1);
+
+  auto plan = PlanADTSStreamFromMP4(file.data(), file.size());
+  EXPECT_TRUE(plan.samples.empty());
+}
+
+TEST(ExtractADTSSadPath, FixedSampleSizeCountOutsideBuffer) {
+  auto file = MakeM4A({100, 100}, {0x12, 0x10});
+
+  // stsz: fixed sample size 100, with a count no buffer could hold.
+  constexpr std::array<uint8_t, 4> kStsz = {'s', 't', 's', 'z'};
+  const auto stsz = std::search(file.begin(), file.end(), kStsz.begin(), kStsz.end());
+  ASSERT_NE(stsz, file.end());
+  const auto offset = static_cast<std::size_t>(stsz - file.begin()) + kStsz.size();
+  parakeet_audio::WriteBigEndian<uint32_t>(&file[offset + 4], 100);
+  parakeet_audio::WriteBigEndian<uint32_t>(&file[offset + 8], 0xFFFFFFF0);
+
+  auto plan = PlanADTSStreamFromMP4(file.data(), file.size());
+  EXPECT_TRUE(plan.samples.empty());
+}
+
+TEST(ExtractADTSSadPath, NotAAC) {
+  // AOT 36 (ALS) can't be carried in ADTS.
+  auto file = MakeM4A({100}, {0xF8, 0x88, 0x40});
+
+  auto plan = PlanADTSStreamFromMP4(file.data(), file.size());
+  EXPECT_TRUE(plan.samples.empty());
+}
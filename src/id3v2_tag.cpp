@@ -0,0 +1,154 @@
+#include "parakeet-audio/id3v2_tag.h"
+#include "parakeet_endian.h"
+#include "parakeet_simd.h"
+
+#include "parakeet-audio/audio_metadata.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace parakeet_audio {
+
+namespace {
+
+constexpr std::size_t kID3v2HeaderSize = 10;
+constexpr std::size_t kID3v2FrameHeaderSize = 10;
+
+// Unsynchronisation inserts a zero after every 0xFF that could be mistaken for a frame sync.
+constexpr uint8_t kID3UnsyncByte0 = 0xFF;
+constexpr uint8_t kID3UnsyncByte1 = 0x00;
+
+/**
+ * @brief Find the first `FF 00` pair in [begin, end).
+ * @return const uint8_t* Position of its `FF`, `end` if none.
+ */
+const uint8_t* FindID3UnsyncPair(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* pos = begin;
+
+#if PARAKEET_AUDIO_HAS_SSE2
+  // Compare 16 bytes against the first byte of the pair and the same 16 bytes shifted by one against the second.
+  constexpr std::ptrdiff_t kBlockSize = 16;
+  const __m128i unsync_lead = _mm_set1_epi8(static_cast<char>(kID3UnsyncByte0));
+  const __m128i unsync_next = _mm_set1_epi8(static_cast<char>(kID3UnsyncByte1));
+  for (; end - pos > kBlockSize; pos += kBlockSize) {
+    // NOLINTBEGIN(*-type-reinterpret-cast)
+    const __m128i lead = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 1));
+    // NOLINTEND(*-type-reinterpret-cast)
+    const __m128i pairs = _mm_and_si128(_mm_cmpeq_epi8(lead, unsync_lead), _mm_cmpeq_epi8(next, unsync_next));
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(pairs)); mask != 0) {
+      return pos + detail::CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  for (; end - pos >= 2; pos++) {
+    if (pos[0] == kID3UnsyncByte0 && pos[1] == kID3UnsyncByte1) {
+      return pos;
+    }
+  }
+  return end;
+}
+
+}  // namespace
+
+std::size_t RemoveID3Unsynchronisation(uint8_t* buffer, std::size_t buffer_len) {
+  // Nothing moves until the first pair, then each run between pairs is moved down in one go.
+  const uint8_t* end = buffer + buffer_len;
+  const uint8_t* read = buffer;
+  uint8_t* write = buffer;
+  while (read < end) {
+    const uint8_t* pair = FindID3UnsyncPair(read, end);
+    const uint8_t* run_end = pair == end ? end : pair + 1;
+    const auto run_len = static_cast<std::size_t>(run_end - read);
+    if (write != read) {
+      std::memmove(write, read, run_len);
+    }
+    write += run_len;
+    read = pair == end ? end : pair + 2;
+  }
+  return static_cast<std::size_t>(write - buffer);
+}
+
+ID3v2Tag DecodeID3v2TagInPlace(uint8_t* buffer, std::size_t buffer_len) {
+  // Header:
+  //   byte[3]("ID3") uint8_t(major) uint8_t(minor) uint8_t(flags) uint32_t(sync safe size)
+  // Extended header:
+  //   v2.3: uint32_t(size, excluding itself) ...
+  //   v2.4: uint32_t(sync safe size, including itself) ...
+  // Frame header:
+  //   uint32_t(id) uint32_t(size, sync safe in v2.4) uint16_t(flags) byte[size] data
+  constexpr std::array<uint8_t, 3> kID3v2Magic = {'I', 'D', '3'};
+  constexpr std::size_t kExtendedHeaderSizeLen = 4;
+  constexpr std::size_t kOffsetVersion = 3;
+  constexpr std::size_t kOffsetFlags = 5;
+  constexpr std::size_t kOffsetTagSize = 6;
+  constexpr std::size_t kOffsetFrameSize = 4;
+  constexpr std::size_t kOffsetFrameFlags = 8;
+
+  ID3v2Tag tag{0, 0, 0, {}};
+  if (buffer_len < kID3v2HeaderSize || !std::equal(kID3v2Magic.begin(), kID3v2Magic.end(), buffer)) {
+    return tag;
+  }
+
+  const uint8_t version = buffer[kOffsetVersion];
+  const uint8_t flags = buffer[kOffsetFlags];
+  const std::size_t tag_size = GetID3HeaderSize(buffer, buffer_len);
+  if ((version != 3 && version != 4) || tag_size == 0 || tag_size > buffer_len) {
+    return tag;
+  }
+
+  // v2.3 unsynchronises the tag as a whole, frame sizes are those of the decoded tag.
+  uint8_t* body = &buffer[kID3v2HeaderSize];
+  std::size_t body_len = static_cast<std::size_t>(ParseID3SyncSafeInt(&buffer[kOffsetTagSize]));
+  if (version == 3 && (flags & kID3v2FlagUnsynchronisation) != 0) {
+    body_len = RemoveID3Unsynchronisation(body, body_len);
+  }
+
+  std::size_t pos = 0;
+  if ((flags & kID3v2FlagExtendedHeader) != 0) {
+    if (body_len < kExtendedHeaderSizeLen) {
+      return tag;
+    }
+    const std::size_t extended_header_size =
+        version == 3 ? kExtendedHeaderSizeLen + ReadBigEndian<uint32_t>(body)
+                     : static_cast<std::size_t>(ParseID3SyncSafeInt(body));
+    if (extended_header_size < kExtendedHeaderSizeLen || extended_header_size > body_len) {
+      return tag;
+    }
+    pos = extended_header_size;
+  }
+
+  // Padding (zero bytes) may follow the last frame.
+  while (body_len - pos >= kID3v2FrameHeaderSize && body[pos] != 0) {
+    const auto frame_id = ReadBigEndian<uint32_t>(&body[pos]);
+    const uint8_t* frame_size_field = &body[pos + kOffsetFrameSize];
+    const std::size_t frame_size = version == 3 ? ReadBigEndian<uint32_t>(frame_size_field)
+                                                : static_cast<std::size_t>(ParseID3SyncSafeInt(frame_size_field));
+    const auto frame_flags = ReadBigEndian<uint16_t>(&body[pos + kOffsetFrameFlags]);
+    if (frame_size == 0 || frame_size > body_len - pos - kID3v2FrameHeaderSize) {
+      break;
+    }
+
+    // v2.4 unsynchronises each frame on its own, frame sizes are those of the stored frame.
+    uint8_t* data = &body[pos + kID3v2FrameHeaderSize];
+    std::size_t data_len = frame_size;
+    if (version == 4 &&
+        ((frame_flags & kID3v2FrameFlagUnsynchronisation) != 0 || (flags & kID3v2FlagUnsynchronisation) != 0)) {
+      data_len = RemoveID3Unsynchronisation(data, frame_size);
+    }
+
+    tag.frames.push_back({frame_id, frame_flags, data, data_len});
+    pos += kID3v2FrameHeaderSize + frame_size;
+  }
+
+  tag.version = version;
+  tag.flags = flags;
+  tag.tag_size = tag_size;
+  return tag;
+}
+
+}  // namespace parakeet_audio
@@ -0,0 +1,176 @@
+#include "parakeet-audio/id3v2_tag.h"
+
+#include "parakeet-audio/audio_metadata.h"
+#include "parakeet_endian.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using parakeet_audio::DecodeID3v2TagInPlace;
+using parakeet_audio::GetID3HeaderSize;
+using parakeet_audio::kID3v2FlagExtendedHeader;
+using parakeet_audio::kID3v2FlagFooter;
+using parakeet_audio::kID3v2FlagUnsynchronisation;
+using parakeet_audio::kID3v2FrameFlagUnsynchronisation;
+using parakeet_audio::RemoveID3Unsynchronisation;
+using ::testing::ElementsAreArray;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+Bytes SyncSafe(std::size_t value) {
+  return {static_cast<uint8_t>((value >> 21) & 0x7F), static_cast<uint8_t>((value >> 14) & 0x7F),
+          static_cast<uint8_t>((value >> 7) & 0x7F), static_cast<uint8_t>(value & 0x7F)};
+}
+
+Bytes Unsynchronise(const Bytes& data) {
+  Bytes result;
+  for (std::size_t i = 0; i < data.size(); i++) {
+    result.push_back(data[i]);
+    if (data[i] == 0xFF && (i + 1 == data.size() || data[i + 1] == 0x00 || data[i + 1] >= 0xE0)) {
+      result.push_back(0x00);
+    }
+  }
+  return result;
+}
+
+Bytes MakeFrame(uint8_t version, const std::string& id, const Bytes& data, uint16_t flags) {
+  Bytes frame(id.begin(), id.end());
+  Bytes size = SyncSafe(data.size());
+  if (version == 3) {
+    parakeet_audio::WriteBigEndian<uint32_t>(size.data(), static_cast<uint32_t>(data.size()));
+  }
+  frame.insert(frame.end(), size.begin(), size.end());
+  frame.push_back(static_cast<uint8_t>(flags >> 8));
+  frame.push_back(static_cast<uint8_t>(flags));
+  frame.insert(frame.end(), data.begin(), data.end());
+  return frame;
+}
+
+Bytes MakeTag(uint8_t version, uint8_t flags, const Bytes& body) {
+  Bytes tag = {'I', 'D', '3', version, 0x00, flags};
+  const Bytes size = SyncSafe(body.size());
+  tag.insert(tag.end(), size.begin(), size.end());
+  tag.insert(tag.end(), body.begin(), body.end());
+  return tag;
+}
+
+// Artwork-like data, dense in the bytes unsynchronisation cares about.
+Bytes MakeNoise(std::size_t len, uint32_t seed) {
+  std::mt19937 rng(seed);
+  Bytes result(len);
+  for (auto& byte : result) {
+    const auto value = rng();
+    byte = (value & 3) == 0 ? 0xFF : (value & 3) == 1 ? 0x00 : static_cast<uint8_t>(value >> 8);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(ID3v2Unsynchronisation, RoundTrip) {
+  for (std::size_t len = 0; len < 100; len++) {
+    const Bytes original = MakeNoise(len, static_cast<uint32_t>(len));
+    Bytes encoded = Unsynchronise(original);
+    encoded.resize(RemoveID3Unsynchronisation(encoded.data(), encoded.size()));
+    EXPECT_THAT(encoded, ElementsAreArray(original)) << "len = " << len;
+  }
+
+  const Bytes original = MakeNoise(1024 * 1024 + 7, 1234);
+  Bytes encoded = Unsynchronise(original);
+  ASSERT_GT(encoded.size(), original.size());
+  encoded.resize(RemoveID3Unsynchronisation(encoded.data(), encoded.size()));
+  EXPECT_EQ(encoded, original);
+}
+
+TEST(ID3v2Unsynchronisation, Pairs) {
+  // Pair across a 16-byte block boundary, pairs back to back, and a 00 after a removed 00.
+  Bytes data(32, 0x11);
+  data[15] = 0xFF;
+  data[16] = 0x00;
+  data.insert(data.end(), {0xFF, 0x00, 0xFF, 0x00, 0x00, 0xFF});
+
+  Bytes expected(32, 0x11);
+  expected[15] = 0xFF;
+  expected.erase(expected.begin() + 16);
+  expected.insert(expected.end(), {0xFF, 0xFF, 0x00, 0xFF});
+
+  data.resize(RemoveID3Unsynchronisation(data.data(), data.size()));
+  EXPECT_THAT(data, ElementsAreArray(expected));
+}
+
+TEST(ID3v2Tag, V23TagWideUnsynchronisation) {
+  const Bytes picture = MakeNoise(5000, 1);
+  Bytes body = {0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};  // extended header
+  const Bytes title = MakeFrame(3, "TIT2", {0x00, 'h', 'i'}, 0);
+  const Bytes apic = MakeFrame(3, "APIC", picture, 0);
+  body.insert(body.end(), title.begin(), title.end());
+  body.insert(body.end(), apic.begin(), apic.end());
+  body = Unsynchronise(body);
+  body.resize(body.size() + 100, 0);  // padding
+
+  Bytes file = MakeTag(3, kID3v2FlagUnsynchronisation | kID3v2FlagExtendedHeader, body);
+  const std::size_t tag_size = file.size();
+  file.insert(file.end(), {0xFF, 0xFB, 0x90, 0x00});
+
+  const auto tag = DecodeID3v2TagInPlace(file.data(), file.size());
+  EXPECT_EQ(tag.version, 3);
+  EXPECT_EQ(tag.tag_size, tag_size);
+  ASSERT_EQ(tag.frames.size(), 2);
+  EXPECT_EQ(tag.frames[0].id, parakeet_audio::ReadBigEndian<uint32_t>(reinterpret_cast<const uint8_t*>("TIT2")));
+  EXPECT_EQ(tag.frames[1].data_len, picture.size());
+  EXPECT_EQ(Bytes(tag.frames[1].data, tag.frames[1].data + tag.frames[1].data_len), picture);
+
+  // Audio after the tag is left alone.
+  EXPECT_EQ(file[tag_size], 0xFF);
+  EXPECT_EQ(file[tag_size + 1], 0xFB);
+}
+
+TEST(ID3v2Tag, V24FrameUnsynchronisationAndFooter) {
+  const Bytes picture = MakeNoise(3000, 2);
+  const Bytes extended_header = {0x00, 0x00, 0x00, 0x06, 0x01, 0x00};
+  const Bytes plain = MakeFrame(4, "TALB", {0x03, 'a', 'l', 'b'}, 0);
+  const Bytes apic = MakeFrame(4, "APIC", Unsynchronise(picture), kID3v2FrameFlagUnsynchronisation);
+
+  Bytes body = extended_header;
+  body.insert(body.end(), plain.begin(), plain.end());
+  body.insert(body.end(), apic.begin(), apic.end());
+  Bytes file = MakeTag(4, kID3v2FlagExtendedHeader | kID3v2FlagFooter, body);
+  Bytes footer(file.begin(), file.begin() + 10);
+  std::copy_n("3DI", 3, footer.begin());
+  file.insert(file.end(), footer.begin(), footer.end());
+  const std::size_t tag_size = file.size();
+  file.resize(file.size() + 64, 0xAA);
+
+  EXPECT_EQ(GetID3HeaderSize(file.data(), file.size()), tag_size);
+
+  const auto tag = DecodeID3v2TagInPlace(file.data(), file.size());
+  EXPECT_EQ(tag.version, 4);
+  EXPECT_EQ(tag.tag_size, tag_size);
+  ASSERT_EQ(tag.frames.size(), 2);
+  EXPECT_EQ(tag.frames[0].data_len, 4);
+  EXPECT_EQ(Bytes(tag.frames[1].data, tag.frames[1].data + tag.frames[1].data_len), picture);
+}
+
+TEST(ID3v2TagSadPath, FooterFlagIgnoredBeforeV24) {
+  Bytes file = MakeTag(3, kID3v2FlagFooter, Bytes(20, 0));
+  EXPECT_EQ(GetID3HeaderSize(file.data(), file.size()), 30);
+}
+
+TEST(ID3v2TagSadPath, Truncated) {
+  Bytes file = MakeTag(4, 0, MakeFrame(4, "TIT2", {0x03, 'x'}, 0));
+  file.pop_back();
+
+  const auto tag = DecodeID3v2TagInPlace(file.data(), file.size());
+  EXPECT_EQ(tag.version, 0);
+  EXPECT_TRUE(tag.frames.empty());
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "parakeet_endian.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+/**
+ * @brief Payload of a MP4 box (without its header).
+ * @private
+ */
+struct MP4Box {
+  uint32_t type;
+  const uint8_t* payload;  // nullptr if not found.
+  std::size_t payload_len;
+};
+
+/**
+ * @brief Call `visitor(const MP4Box&)` for each box in `buffer`, until it returns false.
+ *        Stops at the first box not fitting in `buffer`.
+ * @private
+ */
+template <typename Visitor>
+void ForEachMP4Box(const uint8_t* buffer, std::size_t buffer_len, Visitor visitor) {
+  // uint32_t(size) uint32_t(type) [uint64_t(large_size), if size == 1] byte[] payload
+  // A size of 0 extends the box to the end of its container.
+  constexpr std::size_t kBoxHeaderSize = 8;
+  constexpr std::size_t kBoxLargeHeaderSize = 16;
+
+  std::size_t pos = 0;
+  while (buffer_len - pos >= kBoxHeaderSize) {
+    uint64_t box_size = ReadBigEndian<uint32_t>(&buffer[pos]);
+    const auto type = ReadBigEndian<uint32_t>(&buffer[pos + 4]);
+    std::size_t header_size = kBoxHeaderSize;
+
+    if (box_size == 0) {
+      box_size = buffer_len - pos;
+    } else if (box_size == 1) {
+      if (buffer_len - pos < kBoxLargeHeaderSize) {
+        return;
+      }
+      box_size = ReadBigEndian<uint64_t>(&buffer[pos + kBoxHeaderSize]);
+      header_size = kBoxLargeHeaderSize;
+    }
+
+    if (box_size < header_size || box_size > buffer_len - pos) {
+      return;
+    }
+
+    const MP4Box box{type, &buffer[pos + header_size], static_cast<std::size_t>(box_size) - header_size};
+    if (!visitor(box)) {
+      return;
+    }
+    pos += static_cast<std::size_t>(box_size);
+  }
+}
+
+/**
+ * @brief Find the first box of `type` in `buffer`.
+ * @private
+ *
+ * @return MP4Box `payload` is nullptr if not found.
+ */
+inline MP4Box FindMP4Box(const uint8_t* buffer, std::size_t buffer_len, uint32_t type) {
+  MP4Box result{type, nullptr, 0};
+  ForEachMP4Box(buffer, buffer_len, [&](const MP4Box& box) {
+    if (box.type == type) {
+      result = box;
+      return false;
+    }
+    return true;
+  });
+  return result;
+}
+
+/**
+ * @brief Four-character code of a box type, e.g. `MP4BoxType("moov")`.
+ * @private
+ */
+constexpr uint32_t MP4BoxType(const char (&fourcc)[5]) {  // NOLINT(*-avoid-c-arrays)
+  return (static_cast<uint32_t>(static_cast<uint8_t>(fourcc[0])) << 24) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(fourcc[1])) << 16) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(fourcc[2])) << 8) |
+         static_cast<uint32_t>(static_cast<uint8_t>(fourcc[3]));
+}
+
+}  // namespace parakeet_audio
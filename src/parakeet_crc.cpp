@@ -0,0 +1,208 @@
+#include "parakeet_crc.h"
+#include "parakeet_endian.h"
+#include "parakeet_simd.h"
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace parakeet_audio {
+
+namespace {
+
+constexpr uint32_t kOggCRC32Poly = 0x04C11DB7;
+constexpr uint16_t kFLACCRC16Poly = 0x8005;
+constexpr uint8_t kFLACCRC8Poly = 0x07;
+
+constexpr std::size_t kByteValueCount = UINT8_MAX + 1;
+constexpr std::size_t kSliceCount = sizeof(uint64_t);
+
+template <typename T>
+using SliceBy8Table = std::array<std::array<T, kByteValueCount>, kSliceCount>;
+
+// table[0]: CRC of a single byte; table[k]: CRC of that byte followed by k zero bytes.
+template <typename T, T kPoly>
+constexpr SliceBy8Table<T> MakeSliceBy8Table() {
+  constexpr int kBits = sizeof(T) * CHAR_BIT;
+  constexpr T kTopBit = T{1} << (kBits - 1);
+
+  SliceBy8Table<T> table{};
+  for (uint32_t i = 0; i < kByteValueCount; i++) {
+    auto crc = static_cast<T>(static_cast<T>(i) << (kBits - CHAR_BIT));
+    for (int bit = 0; bit < CHAR_BIT; bit++) {
+      crc = (crc & kTopBit) != 0 ? static_cast<T>((crc << 1) ^ kPoly) : static_cast<T>(crc << 1);
+    }
+    table[0][i] = crc;
+  }
+
+  for (std::size_t k = 1; k < table.size(); k++) {
+    for (std::size_t i = 0; i < kByteValueCount; i++) {
+      const T prev = table[k - 1][i];
+      table[k][i] = static_cast<T>(static_cast<T>(prev << CHAR_BIT) ^ table[0][prev >> (kBits - CHAR_BIT)]);
+    }
+  }
+  return table;
+}
+
+constexpr auto kOggCRC32Table = MakeSliceBy8Table<uint32_t, kOggCRC32Poly>();
+constexpr auto kFLACCRC16Table = MakeSliceBy8Table<uint16_t, kFLACCRC16Poly>();
+constexpr auto kFLACCRC8Table = MakeSliceBy8Table<uint8_t, kFLACCRC8Poly>();
+
+// XOR of the table lookups for each byte of `block`: the k-th byte from the end has k bytes after it, so
+// it is looked up in table[k]. Expanded at compile time.
+template <typename T, std::size_t... kSlices>
+T LookupSlices(const SliceBy8Table<T>& table, uint64_t block, std::index_sequence<kSlices...> /*slices*/) {
+  constexpr uint64_t kByteMask = UINT8_MAX;
+  return static_cast<T>((table[kSlices][(block >> (kSlices * CHAR_BIT)) & kByteMask] ^ ...));
+}
+
+template <typename T>
+T UpdateSliceBy8(const SliceBy8Table<T>& table, T crc, const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr int kBits = sizeof(T) * CHAR_BIT;
+  constexpr int kBlockBits = sizeof(uint64_t) * CHAR_BIT;
+  constexpr uint64_t kByteMask = UINT8_MAX;
+
+  for (; buffer_len >= sizeof(uint64_t); buffer_len -= sizeof(uint64_t), buffer += sizeof(uint64_t)) {
+    const uint64_t block = ReadBigEndian<uint64_t>(buffer) ^ (static_cast<uint64_t>(crc) << (kBlockBits - kBits));
+    crc = LookupSlices(table, block, std::make_index_sequence<kSliceCount>{});
+  }
+
+  for (; buffer_len > 0; buffer_len--, buffer++) {
+    crc = static_cast<T>(static_cast<T>(crc << CHAR_BIT) ^
+                         table[0][((crc >> (kBits - CHAR_BIT)) ^ *buffer) & kByteMask]);
+  }
+  return crc;
+}
+
+#if PARAKEET_AUDIO_X86
+// x^n mod P(x), for the folding constants. `poly` is a 32-bit MSB-first polynomial (x^32 implied).
+constexpr uint32_t CRC32PowerOfX(uint32_t poly, unsigned int n) {
+  constexpr uint32_t kTopBit = 1U << 31;
+
+  uint32_t remainder = 1;
+  for (unsigned int i = 0; i < n; i++) {
+    remainder = (remainder & kTopBit) != 0 ? (remainder << 1) ^ poly : remainder << 1;
+  }
+  return remainder;
+}
+
+// CRC-16 is folded as a CRC-32 over P(x) * x^16: `M * x^32 mod (P * x^16)` is `(M * x^16 mod P) * x^16`,
+// so the 16-bit CRC sits in the top half of the 32-bit register.
+constexpr unsigned int kFLACCRC16FoldShift = 16;
+constexpr uint32_t kFLACCRC16PolyFold = uint32_t{kFLACCRC16Poly} << kFLACCRC16FoldShift;
+
+// Below this, folding setup costs more than it saves.
+constexpr std::size_t kPCLMULMinLength = 64;
+
+constexpr std::size_t kFoldBlockSize = 16;
+using FoldedBlock = std::array<uint8_t, kFoldBlockSize>;
+
+// Shuffle mask reversing the bytes of a block, so the first message bit lands in bit 127.
+constexpr FoldedBlock kByteReverse = {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+
+// `_mm_clmulepi64_si128` selectors: multiply the high / low 64-bit halves of both operands.
+constexpr int kCLMULHighHigh = 0x11;
+constexpr int kCLMULLowLow = 0x00;
+
+/**
+ * Fold 16-byte blocks with carry-less multiplication: with the accumulator `H * x^64 + L` (bit 127 is
+ * the first bit of the message), `acc * x^128 = H * x^192 + L * x^128`, which reduces to
+ * `H * (x^192 mod P) + L * (x^128 mod P)` - at most 96 bits. The final 16-byte accumulator has the same
+ * CRC as the folded blocks, and goes through the table implementation with any leftover bytes, so no
+ * Barrett reduction is needed.
+ *
+ * @param crc32 CRC so far, in the top bits of a 32-bit register.
+ */
+PARAKEET_AUDIO_TARGET_PCLMUL
+FoldedBlock FoldBlocksPCLMUL(uint32_t crc32,
+                             const uint8_t* buffer,
+                             std::size_t block_count,
+                             int64_t fold_high,
+                             int64_t fold_low) {
+  const __m128i fold = _mm_set_epi64x(fold_high, fold_low);
+
+  // NOLINTBEGIN(*-type-reinterpret-cast)
+  const __m128i byte_reverse = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kByteReverse.data()));
+  __m128i acc = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer)), byte_reverse);
+  acc = _mm_xor_si128(acc, _mm_set_epi32(static_cast<int>(crc32), 0, 0, 0));
+
+  for (std::size_t i = 1; i < block_count; i++) {
+    const __m128i next = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[i * kFoldBlockSize])), byte_reverse);
+    acc = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(acc, fold, kCLMULHighHigh),
+                                      _mm_clmulepi64_si128(acc, fold, kCLMULLowLow)),
+                        next);
+  }
+
+  FoldedBlock folded{};
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(folded.data()), _mm_shuffle_epi8(acc, byte_reverse));
+  // NOLINTEND(*-type-reinterpret-cast)
+  return folded;
+}
+
+uint32_t UpdateOggCRC32PCLMUL(uint32_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr auto kFoldHigh = static_cast<int64_t>(CRC32PowerOfX(kOggCRC32Poly, 192));
+  constexpr auto kFoldLow = static_cast<int64_t>(CRC32PowerOfX(kOggCRC32Poly, 128));
+
+  const std::size_t block_count = buffer_len / kFoldBlockSize;
+  const auto folded = FoldBlocksPCLMUL(crc, buffer, block_count, kFoldHigh, kFoldLow);
+  crc = UpdateSliceBy8(kOggCRC32Table, uint32_t{0}, folded.data(), folded.size());
+  const std::size_t folded_len = block_count * kFoldBlockSize;
+  return UpdateSliceBy8(kOggCRC32Table, crc, &buffer[folded_len], buffer_len - folded_len);
+}
+
+uint16_t UpdateFLACCRC16PCLMUL(uint16_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+  constexpr auto kFoldHigh = static_cast<int64_t>(CRC32PowerOfX(kFLACCRC16PolyFold, 192));
+  constexpr auto kFoldLow = static_cast<int64_t>(CRC32PowerOfX(kFLACCRC16PolyFold, 128));
+
+  const std::size_t block_count = buffer_len / kFoldBlockSize;
+  const auto folded = FoldBlocksPCLMUL(uint32_t{crc} << kFLACCRC16FoldShift, buffer, block_count, kFoldHigh, kFoldLow);
+  crc = UpdateSliceBy8(kFLACCRC16Table, uint16_t{0}, folded.data(), folded.size());
+  const std::size_t folded_len = block_count * kFoldBlockSize;
+  return UpdateSliceBy8(kFLACCRC16Table, crc, &buffer[folded_len], buffer_len - folded_len);
+}
+#endif
+
+}  // namespace
+
+namespace detail {
+
+uint32_t UpdateOggCRC32Table(uint32_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+  return UpdateSliceBy8(kOggCRC32Table, crc, buffer, buffer_len);
+}
+
+uint16_t UpdateFLACCRC16Table(uint16_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+  return UpdateSliceBy8(kFLACCRC16Table, crc, buffer, buffer_len);
+}
+
+}  // namespace detail
+
+uint32_t UpdateOggCRC32(uint32_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+#if PARAKEET_AUDIO_X86
+  static const bool kHasPCLMUL = detail::CPUHasPCLMUL();
+  if (kHasPCLMUL && buffer_len >= kPCLMULMinLength) {
+    return UpdateOggCRC32PCLMUL(crc, buffer, buffer_len);
+  }
+#endif
+
+  return detail::UpdateOggCRC32Table(crc, buffer, buffer_len);
+}
+
+uint16_t UpdateFLACCRC16(uint16_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+#if PARAKEET_AUDIO_X86
+  static const bool kHasPCLMUL = detail::CPUHasPCLMUL();
+  if (kHasPCLMUL && buffer_len >= kPCLMULMinLength) {
+    return UpdateFLACCRC16PCLMUL(crc, buffer, buffer_len);
+  }
+#endif
+
+  return detail::UpdateFLACCRC16Table(crc, buffer, buffer_len);
+}
+
+uint8_t UpdateFLACCRC8(uint8_t crc, const uint8_t* buffer, std::size_t buffer_len) {
+  return UpdateSliceBy8(kFLACCRC8Table, crc, buffer, buffer_len);
+}
+
+}  // namespace parakeet_audio
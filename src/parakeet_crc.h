@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+/**
+ * @brief Ogg page CRC-32: polynomial 0x04C11DB7, MSB-first, no reflection, no final xor.
+ * @private
+ *
+ * @param crc Result of previous call, or 0 to start a new checksum.
+ * @param buffer
+ * @param buffer_len
+ * @return uint32_t
+ */
+uint32_t UpdateOggCRC32(uint32_t crc, const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief FLAC frame footer CRC-16: polynomial 0x8005, MSB-first, starts with 0.
+ * @private
+ */
+uint16_t UpdateFLACCRC16(uint16_t crc, const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief FLAC frame header CRC-8: polynomial 0x07, MSB-first, starts with 0.
+ * @private
+ */
+uint8_t UpdateFLACCRC8(uint8_t crc, const uint8_t* buffer, std::size_t buffer_len);
+
+namespace detail {
+
+/**
+ * @brief Table-only (slice-by-8) implementation of `UpdateOggCRC32`, used as reference in tests.
+ * @private
+ */
+uint32_t UpdateOggCRC32Table(uint32_t crc, const uint8_t* buffer, std::size_t buffer_len);
+
+/**
+ * @brief Table-only (slice-by-8) implementation of `UpdateFLACCRC16`, used as reference in tests.
+ * @private
+ */
+uint16_t UpdateFLACCRC16Table(uint16_t crc, const uint8_t* buffer, std::size_t buffer_len);
+
+}  // namespace detail
+
+}  // namespace parakeet_audio
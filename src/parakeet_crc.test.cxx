@@ -0,0 +1,60 @@
+#include "parakeet_crc.h"
+
+#include "audio_test_data.test.hh"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+using parakeet_audio::UpdateFLACCRC16;
+using parakeet_audio::UpdateFLACCRC8;
+using parakeet_audio::UpdateOggCRC32;
+using parakeet_audio::test::FillNoise;
+
+namespace {
+constexpr std::array<uint8_t, 9> kCheckInput = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+}
+
+TEST(AudioCRC, CheckValues) {
+  EXPECT_EQ(UpdateOggCRC32(0, kCheckInput.data(), kCheckInput.size()), 0x89A1897FU);
+  EXPECT_EQ(UpdateFLACCRC16(0, kCheckInput.data(), kCheckInput.size()), 0xFEE8);
+  EXPECT_EQ(UpdateFLACCRC8(0, kCheckInput.data(), kCheckInput.size()), 0xF4);
+}
+
+TEST(AudioCRC, OggCRC32MatchesTableForAllLengths) {
+  std::vector<uint8_t> buffer(1024);
+  FillNoise(buffer.data(), buffer.size(), 0xC0FFEE);
+
+  for (std::size_t len = 0; len <= buffer.size(); len += 7) {
+    EXPECT_EQ(UpdateOggCRC32(0x1234, buffer.data(), len),
+              parakeet_audio::detail::UpdateOggCRC32Table(0x1234, buffer.data(), len))
+        << "len = " << len;
+  }
+}
+
+TEST(AudioCRC, FLACCRC16MatchesTableForAllLengths) {
+  std::vector<uint8_t> buffer(1024);
+  FillNoise(buffer.data(), buffer.size(), 0xF1AC);
+
+  for (std::size_t len = 0; len <= buffer.size(); len += 7) {
+    EXPECT_EQ(UpdateFLACCRC16(0x1234, buffer.data(), len),
+              parakeet_audio::detail::UpdateFLACCRC16Table(0x1234, buffer.data(), len))
+        << "len = " << len;
+  }
+}
+
+TEST(AudioCRC, IncrementalUpdate) {
+  std::vector<uint8_t> buffer(300, 0xA5);
+  const auto whole = UpdateOggCRC32(0, buffer.data(), buffer.size());
+  const auto split = UpdateOggCRC32(UpdateOggCRC32(0, buffer.data(), 100), &buffer[100], 200);
+  EXPECT_EQ(whole, split);
+
+  const auto whole16 = UpdateFLACCRC16(0, buffer.data(), buffer.size());
+  const auto split16 = UpdateFLACCRC16(UpdateFLACCRC16(0, buffer.data(), 3), &buffer[3], 297);
+  EXPECT_EQ(whole16, split16);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARAKEET_AUDIO_HAS_SSE2 1
+#include <emmintrin.h>
+#else
+#define PARAKEET_AUDIO_HAS_SSE2 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PARAKEET_AUDIO_X86 1
+#include <immintrin.h>
+#else
+#define PARAKEET_AUDIO_X86 0
+#endif
+
+#if _MSC_VER
+#include <intrin.h>
+#endif
+
+// Allow use of PCLMULQDQ/SSSE3 intrinsics in a single function, without raising the baseline for the
+// whole library. Callers must check `CPUHasPCLMUL()` first.
+#if PARAKEET_AUDIO_X86 && (__clang__ || __GNUC__)
+#define PARAKEET_AUDIO_TARGET_PCLMUL __attribute__((target("pclmul,ssse3")))
+#else
+#define PARAKEET_AUDIO_TARGET_PCLMUL
+#endif
+
+namespace parakeet_audio::detail {
+
+/**
+ * @brief Index of the lowest set bit. `mask` must not be zero.
+ */
+inline uint32_t CountTrailingZeros(uint32_t mask) {
+#if _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+
+#if PARAKEET_AUDIO_X86
+/**
+ * @brief Whether the CPU supports PCLMULQDQ and SSSE3.
+ */
+inline bool CPUHasPCLMUL() {
+#if _MSC_VER
+  constexpr int kCPUIDFeatureLeaf = 1;
+  constexpr int kECXBitPCLMUL = 1 << 1;
+  constexpr int kECXBitSSSE3 = 1 << 9;
+  std::array<int, 4> cpu_info{};
+  __cpuid(cpu_info.data(), kCPUIDFeatureLeaf);
+  return (cpu_info[2] & kECXBitPCLMUL) != 0 && (cpu_info[2] & kECXBitSSSE3) != 0;
+#else
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+}  // namespace parakeet_audio::detail
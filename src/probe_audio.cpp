@@ -0,0 +1,496 @@
+#include "parakeet-audio/probe_audio.h"
+#include "audio_frame_header.h"
+#include "mp4_box.h"
+#include "parakeet_endian.h"
+
+#include "parakeet-audio/audio_metadata.h"
+#include "parakeet-audio/detect_audio_type.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace parakeet_audio {
+
+namespace {
+
+// Bytes needed after the leading tag for detection, and the first frame / stream header.
+constexpr uint64_t kPostTagMinSize = 16 * 1024;
+
+// Read size when something is out of reach.
+constexpr uint64_t kProbeWindowSize = 64 * 1024;
+
+// ID3v1 (128 bytes) + APEv2 footer (32 bytes).
+constexpr uint64_t kTrailingTagSearchSize = 128 + 32;
+
+// `mvhd` is normally the first child of `moov`: read this much of a large `moov` before all of it.
+// Fits a large box header, then a v1 `mvhd` (120 bytes of payload).
+constexpr uint64_t kMP4MoovHeadSize = 256;
+
+// Frames averaged for the ADTS bitrate.
+constexpr std::size_t kADTSDurationFrames = 64;
+
+struct ByteView {
+  const uint8_t* data;
+  std::size_t len;
+};
+
+class FetchedRanges {
+ public:
+  void Add(uint64_t offset, std::vector<uint8_t> data) {
+    if (!data.empty()) {
+      chunks_.push_back({offset, std::move(data)});
+    }
+  }
+
+  /**
+   * @brief Longest run of fetched bytes starting at `offset`.
+   */
+  [[nodiscard]] ByteView ViewAt(uint64_t offset) const {
+    ByteView best{nullptr, 0};
+    for (const auto& chunk : chunks_) {
+      if (chunk.offset <= offset && offset - chunk.offset < chunk.data.size()) {
+        const auto skip = static_cast<std::size_t>(offset - chunk.offset);
+        if (chunk.data.size() - skip > best.len) {
+          best = {&chunk.data[skip], chunk.data.size() - skip};
+        }
+      }
+    }
+    return best;
+  }
+
+ private:
+  struct Chunk {
+    uint64_t offset;
+    std::vector<uint8_t> data;
+  };
+  std::vector<Chunk> chunks_;
+};
+
+AudioByteRange GetProbeWindow(uint64_t file_size, uint64_t offset) {
+  return {offset, std::min(kProbeWindowSize, file_size - offset)};
+}
+
+double GetMP3Duration(const ByteView& stream, uint64_t payload_len) {
+  // Xing/Info (VBR/CBR from LAME) sits after the side info of the first frame, VBRI (Fraunhofer) at a
+  // fixed 32 bytes after the header. Both give the frame count; otherwise assume CBR.
+  constexpr std::size_t kFrameHeaderSize = 4;
+  constexpr std::size_t kOffsetVBRI = kFrameHeaderSize + 32;
+  constexpr uint32_t kMagicXing = 0x58'69'6E'67U;
+  constexpr uint32_t kMagicInfo = 0x49'6E'66'6FU;
+  constexpr uint32_t kMagicVBRI = 0x56'42'52'49U;
+  constexpr uint32_t kXingFlagFrames = 1;
+  constexpr uint32_t kChannelModeMono = 0b11;
+  constexpr uint32_t kChannelModeShift = 6;
+  constexpr std::size_t kSideInfoSizeMPEG1Mono = 17;
+  constexpr std::size_t kSideInfoSizeMPEG1 = 32;
+  constexpr std::size_t kSideInfoSizeMPEG2Mono = 9;
+  constexpr std::size_t kSideInfoSizeMPEG2 = 17;
+  // Xing: uint32_t(magic) uint32_t(flags) uint32_t(frames) ...
+  constexpr std::size_t kOffsetXingFlags = 4;
+  constexpr std::size_t kOffsetXingFrames = 8;
+  constexpr std::size_t kXingMinSize = 12;
+  // VBRI: uint32_t(magic) uint16_t(version) uint16_t(delay) uint16_t(quality) uint32_t(bytes) uint32_t(frames) ...
+  constexpr std::size_t kOffsetVBRIFrames = 14;
+  constexpr std::size_t kVBRIMinSize = 18;
+
+  const auto info = ParseMPEGAudioFrameHeader(stream.data, stream.len);
+  if (info.frame_size == 0) {
+    return 0;
+  }
+
+  const bool is_mpeg1 = ((stream.data[1] >> 3) & 0b11) == 0b11;
+  const bool is_mono = (stream.data[3] >> kChannelModeShift) == kChannelModeMono;
+  const std::size_t side_info_size = is_mpeg1 ? (is_mono ? kSideInfoSizeMPEG1Mono : kSideInfoSizeMPEG1)
+                                               : (is_mono ? kSideInfoSizeMPEG2Mono : kSideInfoSizeMPEG2);
+  const std::size_t offset_xing = kFrameHeaderSize + side_info_size;
+
+  uint64_t frame_count = 0;
+  if (stream.len >= offset_xing + kXingMinSize) {
+    const auto magic = ReadBigEndian<uint32_t>(&stream.data[offset_xing]);
+    const auto flags = ReadBigEndian<uint32_t>(&stream.data[offset_xing + kOffsetXingFlags]);
+    if ((magic == kMagicXing || magic == kMagicInfo) && (flags & kXingFlagFrames) != 0) {
+      frame_count = ReadBigEndian<uint32_t>(&stream.data[offset_xing + kOffsetXingFrames]);
+    }
+  }
+  if (frame_count == 0 && stream.len >= kOffsetVBRI + kVBRIMinSize &&
+      ReadBigEndian<uint32_t>(&stream.data[kOffsetVBRI]) == kMagicVBRI) {
+    frame_count = ReadBigEndian<uint32_t>(&stream.data[kOffsetVBRI + kOffsetVBRIFrames]);
+  }
+
+  if (frame_count != 0) {
+    return static_cast<double>(frame_count) * info.sample_count / info.sample_rate;
+  }
+  const double frame_count_cbr = static_cast<double>(payload_len) / static_cast<double>(info.frame_size);
+  return frame_count_cbr * info.sample_count / info.sample_rate;
+}
+
+double GetADTSDuration(const ByteView& stream, uint64_t payload_len) {
+  std::size_t pos = 0;
+  std::size_t frames = 0;
+  AudioFrameInfo first{};
+  while (frames < kADTSDurationFrames && pos < stream.len) {
+    const auto info = ParseADTSFrameHeader(&stream.data[pos], stream.len - pos);
+    if (info.frame_size == 0) {
+      break;
+    }
+    first = frames == 0 ? info : first;
+    pos += info.frame_size;
+    frames++;
+  }
+
+  if (frames == 0) {
+    return 0;
+  }
+  const double average_frame_size = static_cast<double>(pos) / static_cast<double>(frames);
+  return static_cast<double>(payload_len) / average_frame_size * first.sample_count / first.sample_rate;
+}
+
+double GetFLACDuration(const ByteView& stream) {
+  // "fLaC", metadata block header, then STREAMINFO:
+  //   uint16_t(min_block) uint16_t(max_block) uint24_t(min_frame) uint24_t(max_frame)
+  //   uint20_t(sample_rate) uint3_t(channels - 1) uint5_t(bits - 1) uint36_t(total_samples) ...
+  constexpr std::size_t kOffsetSampleRate = 8 + 10;
+  constexpr uint32_t kTotalSamplesBits = 36;
+  constexpr uint32_t kSampleRateShift = kTotalSamplesBits + 5 + 3;  // above bits - 1 and channels - 1
+  constexpr uint64_t kTotalSamplesMask = (uint64_t{1} << kTotalSamplesBits) - 1;
+
+  if (stream.len < kOffsetSampleRate + sizeof(uint64_t)) {
+    return 0;
+  }
+  const auto packed = ReadBigEndian<uint64_t>(&stream.data[kOffsetSampleRate]);
+  const uint64_t sample_rate = packed >> kSampleRateShift;
+  const uint64_t total_samples = packed & kTotalSamplesMask;
+  return sample_rate == 0 ? 0 : static_cast<double>(total_samples) / static_cast<double>(sample_rate);
+}
+
+double GetWAVDuration(const ByteView& stream, uint64_t payload_len) {
+  // "RIFF" uint32_t(size) "WAVE", then chunks: uint32_t(id) uint32_t(size, LE) byte[size] (padded to even)
+  // fmt: uint16_t(format) uint16_t(channels) uint32_t(sample_rate) uint32_t(byte_rate) ...
+  constexpr std::size_t kRIFFHeaderSize = 12;
+  constexpr std::size_t kChunkHeaderSize = 8;
+  constexpr std::size_t kOffsetByteRate = 8;
+  constexpr uint32_t kChunkFmt = 0x66'6D'74'20U;
+  constexpr uint32_t kChunkData = 0x64'61'74'61U;
+
+  uint32_t byte_rate = 0;
+  std::size_t pos = kRIFFHeaderSize;
+  while (pos + kChunkHeaderSize <= stream.len) {
+    const auto chunk_id = ReadBigEndian<uint32_t>(&stream.data[pos]);
+    const uint64_t chunk_size = ReadLittleEndian<uint32_t>(&stream.data[pos + 4]);
+
+    if (chunk_id == kChunkFmt && pos + kChunkHeaderSize + kOffsetByteRate + 4 <= stream.len) {
+      byte_rate = ReadLittleEndian<uint32_t>(&stream.data[pos + kChunkHeaderSize + kOffsetByteRate]);
+    } else if (chunk_id == kChunkData) {
+      const uint64_t data_offset = std::min<uint64_t>(payload_len, pos + kChunkHeaderSize);
+      const uint64_t data_size = std::min(chunk_size, payload_len - data_offset);
+      return byte_rate == 0 ? 0 : static_cast<double>(data_size) / byte_rate;
+    }
+    pos += kChunkHeaderSize + static_cast<std::size_t>(chunk_size + (chunk_size & 1));
+  }
+  return 0;
+}
+
+double GetOggDuration(const ByteView& stream, const ByteView& tail) {
+  // First page carries the identification header:
+  //   Vorbis: "\x01vorbis" uint32_t(version) uint8_t(channels) uint32_t(sample_rate) ...
+  //   Opus:   "OpusHead" uint8_t(version) uint8_t(channels) uint16_t(pre_skip) ...; granule is 48kHz
+  // The granule position of the last page is the total sample count.
+  constexpr std::size_t kOggPageHeaderSize = 27;
+  constexpr std::size_t kOffsetGranule = 6;
+  constexpr std::size_t kOffsetVorbisSampleRate = 12;
+  constexpr std::size_t kOffsetOpusPreSkip = 10;
+  constexpr uint64_t kOpusSampleRate = 48000;
+  constexpr uint64_t kGranuleNone = ~uint64_t{0};
+  constexpr std::array<uint8_t, 7> kVorbisMagic = {0x01, 'v', 'o', 'r', 'b', 'i', 's'};
+  constexpr std::array<uint8_t, 8> kOpusMagic = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd'};
+  constexpr std::array<uint8_t, 4> kOggPageMagic = {'O', 'g', 'g', 'S'};
+
+  if (GetOggPageSize(stream.data, stream.len) == 0) {
+    return 0;
+  }
+  const std::size_t body_offset = kOggPageHeaderSize + stream.data[kOggPageHeaderSize - 1];
+  const uint8_t* body = &stream.data[body_offset];
+  const std::size_t body_len = stream.len - std::min(stream.len, body_offset);
+
+  uint64_t sample_rate = 0;
+  uint64_t pre_skip = 0;
+  if (body_len >= kOffsetVorbisSampleRate + 4 && std::equal(kVorbisMagic.begin(), kVorbisMagic.end(), body)) {
+    sample_rate = ReadLittleEndian<uint32_t>(&body[kOffsetVorbisSampleRate]);
+  } else if (body_len >= kOffsetOpusPreSkip + 2 && std::equal(kOpusMagic.begin(), kOpusMagic.end(), body)) {
+    sample_rate = kOpusSampleRate;
+    pre_skip = ReadLittleEndian<uint16_t>(&body[kOffsetOpusPreSkip]);
+  }
+  if (sample_rate == 0 || tail.len < kOggPageHeaderSize) {
+    return 0;
+  }
+
+  for (std::size_t pos = tail.len - kOggPageHeaderSize + 1; pos-- > 0;) {
+    if (std::equal(kOggPageMagic.begin(), kOggPageMagic.end(), &tail.data[pos]) && tail.data[pos + 4] == 0) {
+      const auto granule = ReadLittleEndian<uint64_t>(&tail.data[pos + kOffsetGranule]);
+      if (granule != kGranuleNone) {
+        return static_cast<double>(granule - std::min(granule, pre_skip)) / static_cast<double>(sample_rate);
+      }
+    }
+  }
+  return 0;
+}
+
+double GetMP4Duration(uint64_t file_size,
+                      uint64_t start,
+                      const FetchedRanges& fetched,
+                      std::vector<AudioByteRange>& missing) {
+  // Walk top-level box headers to `moov`, then read `mvhd`:
+  //   v0: uint32_t(version_flags) uint32_t(created) uint32_t(modified) uint32_t(timescale) uint32_t(duration)
+  //   v1: uint32_t(version_flags) uint64_t(created) uint64_t(modified) uint32_t(timescale) uint64_t(duration)
+  constexpr std::size_t kBoxHeaderSize = 8;
+  constexpr std::size_t kBoxLargeHeaderSize = 16;
+  constexpr std::size_t kMaxTopLevelBoxes = 1024;
+  constexpr std::size_t kOffsetBoxType = 4;
+  constexpr std::size_t kMvhdV0Size = 20;
+  constexpr std::size_t kMvhdV0OffsetTimescale = 12;
+  constexpr std::size_t kMvhdV0OffsetDuration = 16;
+  constexpr std::size_t kMvhdV1Size = 32;
+  constexpr std::size_t kMvhdV1OffsetTimescale = 20;
+  constexpr std::size_t kMvhdV1OffsetDuration = 24;
+
+  AudioByteRange moov{0, 0};
+  std::size_t moov_header_size = kBoxHeaderSize;
+  uint64_t pos = start;
+  for (std::size_t i = 0; i < kMaxTopLevelBoxes && file_size - pos >= kBoxHeaderSize; i++) {
+    const auto header = fetched.ViewAt(pos);
+    if (header.len < std::min<uint64_t>(kBoxLargeHeaderSize, file_size - pos)) {
+      // A window, not the rest of the file: when this box is `moov`, its head is all we need.
+      missing.push_back(GetProbeWindow(file_size, pos));
+      return 0;
+    }
+
+    uint64_t box_size = ReadBigEndian<uint32_t>(header.data);
+    moov_header_size = kBoxHeaderSize;
+    if (box_size == 0) {
+      box_size = file_size - pos;
+    } else if (box_size == 1) {
+      if (header.len < kBoxLargeHeaderSize) {
+        return 0;
+      }
+      box_size = ReadBigEndian<uint64_t>(&header.data[kBoxHeaderSize]);
+      moov_header_size = kBoxLargeHeaderSize;
+    }
+    if (box_size < moov_header_size || box_size > file_size - pos) {
+      return 0;
+    }
+
+    if (ReadBigEndian<uint32_t>(&header.data[kOffsetBoxType]) == MP4BoxType("moov")) {
+      moov = {pos, box_size};
+      break;
+    }
+    pos += box_size;
+  }
+  if (moov.length == 0) {
+    return 0;
+  }
+
+  // The child walk stops at the first box not fetched in full, so `mvhd` is found in a partial `moov`.
+  const auto moov_view = fetched.ViewAt(moov.offset);
+  const auto moov_fetched_len = static_cast<std::size_t>(std::min<uint64_t>(moov_view.len, moov.length));
+  MP4Box mvhd{MP4BoxType("mvhd"), nullptr, 0};
+  if (moov_fetched_len > moov_header_size) {
+    mvhd = FindMP4Box(&moov_view.data[moov_header_size], moov_fetched_len - moov_header_size, MP4BoxType("mvhd"));
+  }
+  if (mvhd.payload == nullptr) {
+    const uint64_t moov_head_len = std::min(kMP4MoovHeadSize, moov.length);
+    if (moov_fetched_len < moov_head_len) {
+      missing.push_back({moov.offset, moov_head_len});
+    } else if (moov_fetched_len < moov.length) {
+      missing.push_back(moov);
+    }
+    return 0;
+  }
+
+  uint64_t timescale = 0;
+  uint64_t duration = 0;
+  if (mvhd.payload_len >= kMvhdV0Size && mvhd.payload[0] == 0) {
+    timescale = ReadBigEndian<uint32_t>(&mvhd.payload[kMvhdV0OffsetTimescale]);
+    duration = ReadBigEndian<uint32_t>(&mvhd.payload[kMvhdV0OffsetDuration]);
+  } else if (mvhd.payload_len >= kMvhdV1Size && mvhd.payload[0] == 1) {
+    timescale = ReadBigEndian<uint32_t>(&mvhd.payload[kMvhdV1OffsetTimescale]);
+    duration = ReadBigEndian<uint64_t>(&mvhd.payload[kMvhdV1OffsetDuration]);
+  }
+  return timescale == 0 ? 0 : static_cast<double>(duration) / static_cast<double>(timescale);
+}
+
+/**
+ * @brief Fill `result` from what has been fetched so far.
+ * @return std::vector<AudioByteRange> ranges still needed, empty when done.
+ */
+std::vector<AudioByteRange> AnalyzeProbe(uint64_t file_size, const FetchedRanges& fetched, AudioProbeResult& result) {
+  result.type = AudioType::kUnknownType;
+  result.payload = {0, file_size};
+  result.duration = 0;
+
+  const auto head = fetched.ViewAt(0);
+  if (head.len == 0) {
+    return {GetProbeWindow(file_size, 0)};
+  }
+
+  // The leading tag can be larger than the head we read.
+  const uint64_t tag_len = GetAudioHeaderMetadataSize(head.data, head.len);
+  if (tag_len >= file_size) {
+    return {};
+  }
+  const auto stream = fetched.ViewAt(tag_len);
+  if (stream.len < std::min(kPostTagMinSize, file_size - tag_len)) {
+    return {GetProbeWindow(file_size, tag_len)};
+  }
+
+  const uint64_t stream_len = file_size - tag_len;
+  const uint64_t tail_len = std::min(kTrailingTagSearchSize, stream_len);
+  const auto tail = fetched.ViewAt(file_size - tail_len);
+  if (tail.len < tail_len) {
+    const uint64_t tail_start = file_size - std::min(kAudioProbeTailSize, stream_len);
+    return {{tail_start, file_size - tail_start}};
+  }
+  const uint64_t trailing_len =
+      std::min<uint64_t>(GetAudioTrailingMetadataSize(tail.data, static_cast<std::size_t>(tail_len)), stream_len);
+
+  result.type = DetectAudioType(stream.data, stream.len);
+  result.payload = {tag_len, stream_len - trailing_len};
+
+  std::vector<AudioByteRange> missing;
+  switch (result.type) {
+    case AudioType::kAudioTypeMP3:
+      result.duration = GetMP3Duration(stream, result.payload.length);
+      break;
+    case AudioType::kAudioTypeAAC:
+      result.duration = GetADTSDuration(stream, result.payload.length);
+      break;
+    case AudioType::kAudioTypeFLAC:
+      result.duration = GetFLACDuration(stream);
+      break;
+    case AudioType::kAudioTypeWAV:
+      result.duration = GetWAVDuration(stream, result.payload.length);
+      break;
+
+    case AudioType::kAudioTypeOGG: {
+      // The last page is looked for in the tail already fetched, up to the trailing tags. Only when a
+      // large trailing tag leaves no page there is the window before the tags read.
+      const uint64_t payload_end = tag_len + result.payload.length;
+      const uint64_t window_start = payload_end - std::min(kAudioProbeTailSize, result.payload.length);
+      uint64_t ogg_tail_start = window_start;
+      if (fetched.ViewAt(window_start).len < payload_end - window_start) {
+        const uint64_t fetched_tail_start = file_size - std::min(kAudioProbeTailSize, file_size);
+        ogg_tail_start = std::min(payload_end, std::max(window_start, fetched_tail_start));
+      }
+
+      auto ogg_tail = fetched.ViewAt(ogg_tail_start);
+      ogg_tail.len = static_cast<std::size_t>(std::min<uint64_t>(ogg_tail.len, payload_end - ogg_tail_start));
+      result.duration = GetOggDuration(stream, ogg_tail);
+      if (result.duration == 0 && ogg_tail_start != window_start) {
+        missing.push_back({window_start, payload_end - window_start});
+      }
+      break;
+    }
+
+    case AudioType::kAudioTypeM4A:
+    case AudioType::kAudioTypeM4B:
+    case AudioType::kAudioTypeMP4:
+      result.duration = GetMP4Duration(file_size, tag_len, fetched, missing);
+      break;
+
+    default:
+      break;
+  }
+  return missing;
+}
+
+}  // namespace
+
+AudioRangeReader AudioRangeReader::FromSync(uint64_t file_size, SyncRead read) {
+  return {file_size, [read = std::move(read)](uint64_t offset, uint64_t length) {
+            return std::async(std::launch::async, read, offset, length);
+          }};
+}
+
+AudioRangeReader AudioRangeReader::FromFuture(uint64_t file_size, FutureRead read) {
+  return {file_size, std::move(read)};
+}
+
+AudioRangeReader AudioRangeReader::FromCallback(uint64_t file_size, CallbackRead read) {
+  return {file_size, [read = std::move(read)](uint64_t offset, uint64_t length) {
+            auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+            auto future = promise->get_future();
+            read(offset, length, [promise](std::vector<uint8_t> data) { promise->set_value(std::move(data)); });
+            return future;
+          }};
+}
+
+std::vector<AudioByteRange> CoalesceByteRanges(std::vector<AudioByteRange> ranges, uint64_t max_gap) {
+  ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                              [](const AudioByteRange& range) { return range.length == 0; }),
+               ranges.end());
+  std::sort(ranges.begin(), ranges.end(),
+            [](const AudioByteRange& lhs, const AudioByteRange& rhs) { return lhs.offset < rhs.offset; });
+
+  std::vector<AudioByteRange> result;
+  for (const auto& range : ranges) {
+    if (!result.empty()) {
+      auto& last = result.back();
+      const uint64_t last_end = last.offset + last.length;
+      if (range.offset <= last_end || range.offset - last_end < max_gap) {
+        last.length = std::max(last_end, range.offset + range.length) - last.offset;
+        continue;
+      }
+    }
+    result.push_back(range);
+  }
+  return result;
+}
+
+std::vector<AudioByteRange> PlanAudioProbeRanges(uint64_t file_size) {
+  const uint64_t tail_len = std::min(kAudioProbeTailSize, file_size);
+  return CoalesceByteRanges(
+      {
+          {0, std::min(kAudioProbeHeadSize, file_size)},
+          {file_size - tail_len, tail_len},
+      },
+      kAudioProbeCoalesceGap);
+}
+
+AudioProbeResult ProbeAudio(const AudioRangeReader& reader) {
+  const uint64_t file_size = reader.GetFileSize();
+  AudioProbeResult result{AudioType::kUnknownType, {0, file_size}, 0, 0, 0};
+
+  FetchedRanges fetched;
+  auto ranges = PlanAudioProbeRanges(file_size);
+  while (!ranges.empty() && result.round_trips < kAudioProbeMaxRoundTrips) {
+    // Issue every read of this round before waiting on any of them.
+    std::vector<AudioRangeReader::BufferFuture> pending;
+    pending.reserve(ranges.size());
+    for (const auto& range : ranges) {
+      pending.push_back(reader.Read(range));
+    }
+
+    bool received = false;
+    for (std::size_t i = 0; i < ranges.size(); i++) {
+      auto data = pending[i].get();
+      result.bytes_read += data.size();
+      received = received || !data.empty();
+      fetched.Add(ranges[i].offset, std::move(data));
+    }
+    result.round_trips++;
+
+    auto missing = AnalyzeProbe(file_size, fetched, result);
+    if (!received) {
+      break;
+    }
+    ranges = CoalesceByteRanges(std::move(missing), kAudioProbeCoalesceGap);
+  }
+  return result;
+}
+
+}  // namespace parakeet_audio
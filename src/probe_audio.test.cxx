@@ -0,0 +1,323 @@
+#include "parakeet-audio/probe_audio.h"
+
+#include "audio_test_data.test.hh"
+#include "parakeet_endian.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using parakeet_audio::AudioByteRange;
+using parakeet_audio::AudioRangeReader;
+using parakeet_audio::AudioType;
+using parakeet_audio::CoalesceByteRanges;
+using parakeet_audio::kAudioProbeHeadSize;
+using parakeet_audio::kAudioProbeTailSize;
+using parakeet_audio::PlanAudioProbeRanges;
+using parakeet_audio::ProbeAudio;
+using parakeet_audio::test::AppendAPEv2;
+using parakeet_audio::test::Box;
+using parakeet_audio::test::kMP3FrameSize;
+using parakeet_audio::test::WriteMP3Frames;
+using parakeet_audio::test::WriteOggPage;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+void Append(Bytes& buffer, const std::string& text) {
+  buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+// Serve reads from memory, recording the ranges asked for.
+class MemoryFile {
+ public:
+  explicit MemoryFile(Bytes data) : data_(std::move(data)) {}
+
+  std::vector<uint8_t> Read(uint64_t offset, uint64_t length) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back({offset, length});
+    const auto begin = static_cast<std::size_t>(std::min<uint64_t>(offset, data_.size()));
+    const auto end = static_cast<std::size_t>(std::min<uint64_t>(offset + length, data_.size()));
+    return {data_.begin() + begin, data_.begin() + end};
+  }
+
+  AudioRangeReader MakeReader() {
+    return AudioRangeReader::FromSync(data_.size(), [this](uint64_t offset, uint64_t length) {
+      return Read(offset, length);
+    });
+  }
+
+  [[nodiscard]] const std::vector<AudioByteRange>& GetRequests() const { return requests_; }
+
+ private:
+  Bytes data_;
+  std::mutex mutex_;
+  std::vector<AudioByteRange> requests_;
+};
+
+Bytes MakeMP3Frames(std::size_t frame_count) {
+  Bytes result(frame_count * kMP3FrameSize, 0);
+  WriteMP3Frames(result.data(), frame_count);
+  return result;
+}
+
+Bytes MakeID3v2(std::size_t body_len) {
+  Bytes result = {'I', 'D', '3', 0x04, 0x00, 0x00};
+  for (int shift = 21; shift >= 0; shift -= 7) {
+    result.push_back(static_cast<uint8_t>((body_len >> shift) & 0x7F));
+  }
+  result.resize(result.size() + body_len, 0);
+  return result;
+}
+
+Bytes Concat(std::initializer_list<Bytes> parts) {
+  Bytes result;
+  for (const auto& part : parts) {
+    result.insert(result.end(), part.begin(), part.end());
+  }
+  return result;
+}
+
+// mvhd v0: 1000 units per second, 123.456s
+Bytes MakeMvhd() {
+  Bytes mvhd_body(100, 0);
+  parakeet_audio::WriteBigEndian<uint32_t>(&mvhd_body[12], 1000);
+  parakeet_audio::WriteBigEndian<uint32_t>(&mvhd_body[16], 123456);
+  return Box("mvhd", mvhd_body);
+}
+
+Bytes MakeM4A(const Bytes& moov_body, std::size_t mdat_len, bool moov_first) {
+  const Bytes ftyp = Box("ftyp", {'M', '4', 'A', ' ', 0, 0, 0, 0, 'M', '4', 'A', ' ', 'i', 's', 'o', 'm'});
+  const Bytes mdat = Box("mdat", Bytes(mdat_len, 0x5A));
+  const Bytes moov = Box("moov", moov_body);
+  return moov_first ? Concat({ftyp, moov, mdat}) : Concat({ftyp, mdat, moov});
+}
+
+// Vorbis at 44.1kHz: identification header page, then `page_count` pages of 0.1s each.
+Bytes MakeOggVorbis(std::size_t page_count) {
+  auto make_page = [](uint64_t granule, const Bytes& body) {
+    Bytes page(28);
+    page.insert(page.end(), body.begin(), body.end());
+    WriteOggPage(page.data(), 1, static_cast<uint8_t>(body.size()), granule);
+    return page;
+  };
+
+  Bytes identification = {0x01, 'v', 'o', 'r', 'b', 'i', 's', 0, 0, 0, 0, 2};
+  identification.resize(30, 0);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&identification[12], 44100);
+
+  Bytes file = make_page(0, identification);
+  for (uint64_t i = 1; i <= page_count; i++) {
+    const auto page = make_page(i * 4410, Bytes(200, static_cast<uint8_t>(i)));
+    file.insert(file.end(), page.begin(), page.end());
+  }
+  return file;
+}
+
+}  // namespace
+
+TEST(ProbeAudio, CoalesceByteRanges) {
+  auto ranges = CoalesceByteRanges({{300, 50}, {0, 100}, {120, 10}, {90, 20}, {500, 0}}, 20);
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(ranges[0].offset, 0);
+  EXPECT_EQ(ranges[0].length, 130);
+  EXPECT_EQ(ranges[1].offset, 300);
+  EXPECT_EQ(ranges[1].length, 50);
+}
+
+TEST(ProbeAudio, PlanHeadAndTail) {
+  auto small = PlanAudioProbeRanges(100 * 1024);
+  ASSERT_EQ(small.size(), 1);
+  EXPECT_EQ(small[0].offset, 0);
+  EXPECT_EQ(small[0].length, 100 * 1024);
+
+  auto large = PlanAudioProbeRanges(10 * 1024 * 1024);
+  ASSERT_EQ(large.size(), 2);
+  EXPECT_EQ(large[0].length, kAudioProbeHeadSize);
+  EXPECT_EQ(large[1].offset + large[1].length, 10 * 1024 * 1024);
+}
+
+TEST(ProbeAudio, MP3WithLargeTags) {
+  // Leading tag pushes the first frame out of the head.
+  const Bytes id3v2 = MakeID3v2(200 * 1024);
+  const Bytes frames = MakeMP3Frames(2000);
+  Bytes ape_tag(64, 0);
+  Bytes ape_footer(32, 0);
+  std::copy_n("APETAGEX", 8, ape_footer.begin());
+  parakeet_audio::WriteLittleEndian<uint32_t>(&ape_footer[12], 64 + 32);
+  Bytes id3v1(128, 0);
+  std::copy_n("TAG", 3, id3v1.begin());
+
+  Bytes file = id3v2;
+  file.insert(file.end(), frames.begin(), frames.end());
+  file.insert(file.end(), ape_tag.begin(), ape_tag.end());
+  file.insert(file.end(), ape_footer.begin(), ape_footer.end());
+  file.insert(file.end(), id3v1.begin(), id3v1.end());
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_EQ(result.type, AudioType::kAudioTypeMP3);
+  EXPECT_EQ(result.payload.offset, id3v2.size());
+  EXPECT_EQ(result.payload.length, frames.size());
+  EXPECT_NEAR(result.duration, 2000 * 1152 / 44100.0, 0.01);
+  EXPECT_EQ(result.round_trips, 2);
+  EXPECT_EQ(memory_file.GetRequests().size(), 3);
+  EXPECT_LT(result.bytes_read, file.size() / 2);
+}
+
+TEST(ProbeAudio, FLACSingleRead) {
+  Bytes file = {'f', 'L', 'a', 'C', 0x80, 0x00, 0x00, 0x22};
+  Bytes stream_info(34, 0);
+  // 48kHz, stereo, 16-bit, 480000 samples
+  const uint64_t packed = (uint64_t{48000} << 44) | (uint64_t{1} << 41) | (uint64_t{15} << 36) | 480000;
+  parakeet_audio::WriteBigEndian<uint64_t>(&stream_info[10], packed);
+  file.insert(file.end(), stream_info.begin(), stream_info.end());
+  file.resize(20 * 1024, 0xAA);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_EQ(result.type, AudioType::kAudioTypeFLAC);
+  EXPECT_DOUBLE_EQ(result.duration, 10.0);
+  EXPECT_EQ(result.round_trips, 1);
+  EXPECT_EQ(result.bytes_read, file.size());
+  ASSERT_EQ(memory_file.GetRequests().size(), 1);
+}
+
+TEST(ProbeAudio, WAVFromCallback) {
+  // 44.1kHz, stereo, 16-bit: 176400 bytes per second.
+  Bytes file;
+  Append(file, "RIFF");
+  file.resize(file.size() + 4);
+  Append(file, "WAVEfmt ");
+  file.resize(file.size() + 4 + 16);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&file[16], 16);
+  parakeet_audio::WriteLittleEndian<uint16_t>(&file[20], 1);
+  parakeet_audio::WriteLittleEndian<uint16_t>(&file[22], 2);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&file[24], 44100);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&file[28], 176400);
+  Append(file, "data");
+  file.resize(file.size() + 4);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&file[40], 176400 * 2);
+  file.resize(file.size() + 176400 * 2, 0);
+  parakeet_audio::WriteLittleEndian<uint32_t>(&file[4], static_cast<uint32_t>(file.size() - 8));
+
+  // Complete on another thread, as an async client would.
+  std::vector<std::thread> workers;
+  auto reader = AudioRangeReader::FromCallback(
+      file.size(), [&](uint64_t offset, uint64_t length, std::function<void(std::vector<uint8_t>)> on_complete) {
+        workers.emplace_back([&file, offset, length, on_complete = std::move(on_complete)]() {
+          const auto end = static_cast<std::size_t>(std::min<uint64_t>(offset + length, file.size()));
+          on_complete({file.begin() + static_cast<std::ptrdiff_t>(offset), file.begin() + end});
+        });
+      });
+
+  auto result = ProbeAudio(reader);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(result.type, AudioType::kAudioTypeWAV);
+  EXPECT_DOUBLE_EQ(result.duration, 2.0);
+  EXPECT_EQ(result.round_trips, 1);
+  EXPECT_EQ(workers.size(), 2);
+}
+
+TEST(ProbeAudio, MP4MoovAtEnd) {
+  const Bytes file = MakeM4A(Concat({MakeMvhd(), Box("udta", Bytes(100 * 1024, 0))}), 1024 * 1024, false);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_EQ(result.type, AudioType::kAudioTypeM4A);
+  EXPECT_DOUBLE_EQ(result.duration, 123.456);
+  EXPECT_EQ(result.round_trips, 2);
+  EXPECT_LT(result.bytes_read, file.size() / 2);
+}
+
+TEST(ProbeAudio, MP4LargeMoovAtFront) {
+  // A long file: a large sample table follows mvhd, moov does not fit in the head.
+  const Bytes file = MakeM4A(Concat({MakeMvhd(), Box("trak", Bytes(4 * 1024 * 1024, 0))}), 1024 * 1024, true);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_EQ(result.type, AudioType::kAudioTypeM4A);
+  EXPECT_DOUBLE_EQ(result.duration, 123.456);
+  EXPECT_EQ(result.round_trips, 1);
+  EXPECT_EQ(result.bytes_read, kAudioProbeHeadSize + kAudioProbeTailSize);
+}
+
+TEST(ProbeAudio, MP4LargeMoovAtEndReadsItsHead) {
+  const Bytes file =
+      MakeM4A(Concat({MakeMvhd(), Box("trak", Bytes(2 * 1024 * 1024, 0))}), 8 * 1024 * 1024, false);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_DOUBLE_EQ(result.duration, 123.456);
+  EXPECT_EQ(result.round_trips, 2);
+  for (const auto& request : memory_file.GetRequests()) {
+    EXPECT_LE(request.length, kAudioProbeHeadSize);
+  }
+}
+
+TEST(ProbeAudio, MP4MvhdAfterLargeChild) {
+  // mvhd is not at the front: only then is the whole moov read.
+  const Bytes file = MakeM4A(Concat({Box("udta", Bytes(1024 * 1024, 0)), MakeMvhd()}), 1024 * 1024, true);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_DOUBLE_EQ(result.duration, 123.456);
+  EXPECT_EQ(result.round_trips, 2);
+}
+
+TEST(ProbeAudio, OggVorbisDuration) {
+  const Bytes file = MakeOggVorbis(1000);
+
+  MemoryFile memory_file(file);
+  auto result = ProbeAudio(memory_file.MakeReader());
+  EXPECT_EQ(result.type, AudioType::kAudioTypeOGG);
+  EXPECT_DOUBLE_EQ(result.duration, 100.0);
+  EXPECT_EQ(result.round_trips, 1);
+}
+
+TEST(ProbeAudio, OggWithTrailingTags) {
+  const Bytes ogg = MakeOggVorbis(1000);
+
+  for (uint32_t items_len : {1000U, 100U * 1024U}) {
+    Bytes file = ogg;
+    AppendAPEv2(file, items_len, false);
+    const std::size_t tags_len = file.size() - ogg.size();
+
+    MemoryFile memory_file(file);
+    auto result = ProbeAudio(memory_file.MakeReader());
+    EXPECT_EQ(result.type, AudioType::kAudioTypeOGG);
+    EXPECT_EQ(result.payload.length, file.size() - tags_len);
+    EXPECT_DOUBLE_EQ(result.duration, 100.0) << "items_len = " << items_len;
+
+    // Only a tag larger than the tail needs another read.
+    EXPECT_EQ(result.round_trips, items_len < 64 * 1024 ? 1 : 2);
+  }
+}
+
+TEST(ProbeAudioSadPath, ReadFailurePropagates) {
+  auto reader = AudioRangeReader::FromSync(1024, [](uint64_t, uint64_t) -> std::vector<uint8_t> {
+    throw std::runtime_error("network down");
+  });
+  EXPECT_THROW(ProbeAudio(reader), std::runtime_error);
+}
+
+TEST(ProbeAudioSadPath, ShortReadsStop) {
+  auto reader = AudioRangeReader::FromSync(10 * 1024 * 1024, [](uint64_t, uint64_t) { return std::vector<uint8_t>{}; });
+  auto result = ProbeAudio(reader);
+  EXPECT_EQ(result.type, AudioType::kUnknownType);
+  EXPECT_EQ(result.round_trips, 1);
+  EXPECT_EQ(result.bytes_read, 0);
+}
@@ -0,0 +1,218 @@
+#include "parakeet-audio/score_audio.h"
+#include "audio_frame_header.h"
+#include "parakeet_endian.h"
+
+#include "parakeet-audio/audio_metadata.h"
+#include "parakeet-audio/detect_audio_type.h"
+#include "parakeet-audio/verify_audio.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace parakeet_audio {
+
+namespace {
+
+using ByteHistogram = std::array<uint32_t, UINT8_MAX + 1>;
+
+// Frames needed back-to-back for a block to count as holding MP3/ADTS data.
+constexpr std::size_t kMinFrameRun = 3;
+
+// z-score of the byte histogram: below `kRandomZ` looks random, `kRandomZ + kAudioZSpan` and above looks
+// like audio data.
+constexpr double kRandomZ = 4.0;
+constexpr double kAudioZSpan = 16.0;
+
+// Weight of the format-aware check, when the type has one.
+constexpr double kStructureWeight = 0.75;
+
+/**
+ * @brief Byte histogram over 4 interleaved tables, so runs of the same byte value do not stall on
+ *        incrementing the same counter; `Merge` folds them back together.
+ */
+class HistogramAccumulator {
+ public:
+  void Accumulate(const uint8_t* buffer, std::size_t buffer_len) {
+    for (; buffer_len >= sizeof(uint64_t); buffer_len -= sizeof(uint64_t), buffer += sizeof(uint64_t)) {
+      AccumulateWord(ReadLittleEndian<uint64_t>(buffer), std::make_index_sequence<sizeof(uint64_t)>{});
+    }
+
+    for (; buffer_len > 0; buffer_len--, buffer++) {
+      lanes_[0][*buffer]++;
+    }
+  }
+
+  [[nodiscard]] ByteHistogram Merge() const {
+    ByteHistogram histogram{};
+    for (std::size_t i = 0; i < histogram.size(); i++) {
+      histogram[i] = lanes_[0][i] + lanes_[1][i] + lanes_[2][i] + lanes_[3][i];
+    }
+    return histogram;
+  }
+
+ private:
+  static constexpr std::size_t kLaneCount = 4;
+
+  // Byte k of `word` goes to lane k % 4. Expanded at compile time.
+  template <std::size_t... kBytes>
+  void AccumulateWord(uint64_t word, std::index_sequence<kBytes...> /*bytes*/) {
+    constexpr uint64_t kByteMask = UINT8_MAX;
+    (lanes_[kBytes % kLaneCount][(word >> (kBytes * CHAR_BIT)) & kByteMask]++, ...);
+  }
+
+  std::array<ByteHistogram, kLaneCount> lanes_{};
+};
+
+double GetEntropy(const ByteHistogram& histogram, std::size_t total) {
+  double entropy = 0.0;
+  for (auto count : histogram) {
+    if (count != 0) {
+      const double probability = static_cast<double>(count) / static_cast<double>(total);
+      entropy -= probability * std::log2(probability);
+    }
+  }
+  return entropy;
+}
+
+double GetRandomnessZ(const ByteHistogram& histogram, std::size_t total) {
+  // Chi-square with k degrees of freedom: mean k, variance 2k.
+  constexpr double kDegreesOfFreedom = 255.0;
+  constexpr double kVariance = 2.0 * kDegreesOfFreedom;
+
+  const double expected = static_cast<double>(total) / static_cast<double>(histogram.size());
+  double chi_square = 0.0;
+  for (auto count : histogram) {
+    const double delta = static_cast<double>(count) - expected;
+    chi_square += delta * delta / expected;
+  }
+  return (chi_square - kDegreesOfFreedom) / std::sqrt(kVariance);
+}
+
+template <typename FrameParser>
+bool HasFrameRunAt(const uint8_t* buffer, std::size_t buffer_len, FrameParser parse_frame) {
+  std::size_t pos = 0;
+  uint32_t sample_rate = 0;
+  for (std::size_t frames = 0; frames < kMinFrameRun; frames++) {
+    // A run cut short by the end of buffer still counts.
+    if (pos == buffer_len && frames > 0) {
+      return true;
+    }
+
+    const auto info = parse_frame(&buffer[pos], buffer_len - pos);
+    if (info.frame_size == 0 || info.frame_size > buffer_len - pos ||
+        (frames > 0 && info.sample_rate != sample_rate)) {
+      return false;
+    }
+    sample_rate = info.sample_rate;
+    pos += info.frame_size;
+  }
+  return true;
+}
+
+template <typename FrameParser>
+bool BlockHasFrameRun(const uint8_t* buffer,
+                      std::size_t buffer_len,
+                      std::size_t block_start,
+                      std::size_t block_end,
+                      FrameParser parse_frame) {
+  for (std::size_t pos = block_start; pos < block_end; pos++) {
+    pos = static_cast<std::size_t>(std::find(&buffer[pos], &buffer[block_end], kFrameSyncByte0) - buffer);
+    if (pos < block_end && HasFrameRunAt(&buffer[pos], buffer_len - pos, parse_frame)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+AudioPayloadScore ScoreAudioPayload(const uint8_t* buffer,
+                                    std::size_t buffer_len,
+                                    std::size_t block_size,
+                                    std::size_t block_count) {
+  AudioPayloadScore result{};
+  result.type = DetectAudioType(buffer, buffer_len);
+  result.payload_offset = std::min(GetAudioHeaderMetadataSize(buffer, buffer_len), buffer_len);
+  result.structure_rate = -1.0;
+
+  // FLAC metadata, cover art included, holds no frame to check: sample from the first frame on.
+  if (result.type == AudioType::kAudioTypeFLAC) {
+    result.payload_offset += GetFLACMetadataSize(&buffer[result.payload_offset], buffer_len - result.payload_offset);
+  }
+
+  const std::size_t span = buffer_len - result.payload_offset;
+  if (span == 0 || block_size == 0 || block_count == 0) {
+    return result;
+  }
+
+  // Small payloads are sampled whole, in one block.
+  if (span <= block_size * block_count) {
+    block_size = span;
+    block_count = 1;
+  }
+
+  const bool has_unit_checksums =
+      result.type == AudioType::kAudioTypeOGG || result.type == AudioType::kAudioTypeFLAC;
+
+  HistogramAccumulator accumulator;
+  std::size_t structure_blocks = block_count;
+  std::size_t structure_hits = 0;
+  std::size_t unit_overrun_bytes = 0;
+  for (std::size_t i = 0; i < block_count; i++) {
+    const std::size_t block_start =
+        result.payload_offset + (span - block_size) * i / std::max<std::size_t>(block_count - 1, 1);
+    const std::size_t block_end = block_start + block_size;
+    accumulator.Accumulate(&buffer[block_start], block_size);
+
+    if ((result.type == AudioType::kAudioTypeMP3 &&
+         BlockHasFrameRun(buffer, buffer_len, block_start, block_end, ParseMPEGAudioFrameHeader)) ||
+        (result.type == AudioType::kAudioTypeAAC &&
+         BlockHasFrameRun(buffer, buffer_len, block_start, block_end, ParseADTSFrameHeader))) {
+      structure_hits++;
+    }
+
+    if (has_unit_checksums) {
+      // A block inside the last page / frame has no unit left to check: leave it out.
+      const auto report = VerifyAudioIntegrityBlock(buffer, buffer_len, block_start, block_end);
+      if (report.units_checked == 0 && buffer_len - block_end < kAudioIntegrityBlockOverrun) {
+        structure_blocks--;
+      } else if (report.units_checked != 0 && report.units_valid == report.units_checked) {
+        structure_hits++;
+      }
+      unit_overrun_bytes += std::max(report.checked_end, block_end) - block_end;
+    }
+  }
+
+  result.bytes_sampled = block_size * block_count + unit_overrun_bytes;
+  const auto histogram = accumulator.Merge();
+  result.entropy = GetEntropy(histogram, block_size * block_count);
+  result.randomness_z = GetRandomnessZ(histogram, block_size * block_count);
+
+  switch (result.type) {
+    case AudioType::kAudioTypeMP3:
+    case AudioType::kAudioTypeAAC:
+    case AudioType::kAudioTypeOGG:
+    case AudioType::kAudioTypeFLAC:
+      result.structure_rate =
+          structure_blocks == 0 ? 0.0 : static_cast<double>(structure_hits) / static_cast<double>(structure_blocks);
+      break;
+
+    default:
+      break;
+  }
+
+  const double statistical_score = std::clamp((result.randomness_z - kRandomZ) / kAudioZSpan, 0.0, 1.0);
+  if (result.structure_rate < 0) {
+    result.score = statistical_score;
+  } else {
+    result.score = kStructureWeight * result.structure_rate + (1.0 - kStructureWeight) * statistical_score;
+  }
+  return result;
+}
+
+}  // namespace parakeet_audio
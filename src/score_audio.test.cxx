@@ -0,0 +1,154 @@
+#include "parakeet-audio/score_audio.h"
+
+#include "audio_test_data.test.hh"
+#include "parakeet_endian.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using parakeet_audio::AudioType;
+using parakeet_audio::ScoreAudioPayload;
+using parakeet_audio::test::AppendFLACFrame;
+using parakeet_audio::test::FillNoise;
+using parakeet_audio::test::kMP3FrameSize;
+using parakeet_audio::test::MakeFLACStreamHeader;
+using parakeet_audio::test::WriteMP3Frames;
+using parakeet_audio::test::WriteOggPage;
+
+namespace {
+
+std::vector<uint8_t> MakeMP3(std::size_t frame_count) {
+  std::vector<uint8_t> buffer(frame_count * kMP3FrameSize);
+  FillNoise(buffer.data(), buffer.size(), 0xBEEF);
+  WriteMP3Frames(buffer.data(), frame_count);
+  return buffer;
+}
+
+std::vector<uint8_t> MakeWAV(std::size_t sample_count) {
+  std::vector<uint8_t> buffer(0x2C + sample_count * 2);
+  std::copy_n("RIFF", 4, buffer.data());
+  std::copy_n("WAVE", 4, &buffer[8]);
+  for (std::size_t i = 0; i < sample_count; i++) {
+    const auto sample = static_cast<int16_t>(8000.0 * std::sin(static_cast<double>(i) * 0.05));
+    parakeet_audio::WriteLittleEndian<uint16_t>(&buffer[0x2C + i * 2], static_cast<uint16_t>(sample));
+  }
+  return buffer;
+}
+
+// Ogg stream of `page_count` pages, each with 16 full segments of noise and a valid CRC.
+std::vector<uint8_t> MakeOgg(std::size_t page_count) {
+  constexpr std::size_t kSegmentCount = 16;
+  constexpr std::size_t kPageSize = 27 + kSegmentCount + kSegmentCount * 255;
+
+  std::vector<uint8_t> buffer(page_count * kPageSize);
+  FillNoise(buffer.data(), buffer.size(), 0x0665);
+  for (std::size_t i = 0; i < page_count; i++) {
+    WriteOggPage(&buffer[i * kPageSize], kSegmentCount, 255, 0, static_cast<uint32_t>(i));
+  }
+  return buffer;
+}
+
+// Ogg stream whose first page is intact, followed by `body_len` bytes decrypted with a wrong key.
+std::vector<uint8_t> MakeOggWithRandomBody(std::size_t body_len) {
+  auto buffer = MakeOgg(1);
+  const std::size_t header_len = buffer.size();
+  buffer.resize(header_len + body_len);
+  FillNoise(&buffer[header_len], body_len, 0x5EED);
+  return buffer;
+}
+
+}  // namespace
+
+TEST(AudioPayloadScore, MP3FrameSync) {
+  auto buffer = MakeMP3(200);
+
+  auto good = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(good.type, AudioType::kAudioTypeMP3);
+  EXPECT_DOUBLE_EQ(good.structure_rate, 1.0);
+  EXPECT_GE(good.score, 0.75);
+
+  // Wrong key: header decrypts fine, body does not.
+  FillNoise(&buffer[4], buffer.size() - 4, 0x5EED);
+  auto bad = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(bad.type, AudioType::kAudioTypeMP3);
+  EXPECT_LT(bad.structure_rate, 0.2);
+  EXPECT_LT(bad.score, 0.2);
+  EXPECT_GT(bad.entropy, 7.9);
+}
+
+TEST(AudioPayloadScore, ID3PayloadOffset) {
+  auto buffer = MakeMP3(50);
+  const std::array<uint8_t, 10> id3 = {'I', 'D', '3', 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16};
+  buffer.insert(buffer.begin(), 0x20, 0);
+  std::copy(id3.begin(), id3.end(), buffer.begin());
+
+  auto score = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(score.payload_offset, 0x20);
+  EXPECT_DOUBLE_EQ(score.structure_rate, 1.0);
+}
+
+TEST(AudioPayloadScore, StatisticsOnly) {
+  auto buffer = MakeWAV(100000);
+
+  auto good = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(good.type, AudioType::kAudioTypeWAV);
+  EXPECT_LT(good.structure_rate, 0.0);
+  EXPECT_EQ(good.bytes_sampled, parakeet_audio::kAudioScoreBlockSize * parakeet_audio::kAudioScoreBlockCount);
+  EXPECT_DOUBLE_EQ(good.score, 1.0);
+
+  FillNoise(&buffer[0x2C], buffer.size() - 0x2C, 0x5EED);
+  auto bad = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_LT(std::abs(bad.randomness_z), 4.0);
+  EXPECT_DOUBLE_EQ(bad.score, 0.0);
+}
+
+TEST(AudioPayloadScore, OggPageChecksums) {
+  auto buffer = MakeOgg(200);
+
+  auto good = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(good.type, AudioType::kAudioTypeOGG);
+  EXPECT_DOUBLE_EQ(good.structure_rate, 1.0);
+  EXPECT_GT(good.bytes_sampled, parakeet_audio::kAudioScoreBlockSize * parakeet_audio::kAudioScoreBlockCount);
+  EXPECT_GE(good.score, 0.75);
+
+  auto bad_buffer = MakeOggWithRandomBody(buffer.size());
+  auto bad = ScoreAudioPayload(bad_buffer.data(), bad_buffer.size());
+  EXPECT_EQ(bad.type, AudioType::kAudioTypeOGG);
+  EXPECT_LT(bad.structure_rate, 0.2);
+  EXPECT_LT(bad.score, 0.2);
+}
+
+TEST(AudioPayloadScore, FLACCoverArtIsNotSampled) {
+  // 3 MiB of cover art before 2 MiB of frames.
+  auto buffer = MakeFLACStreamHeader(3 * 1024 * 1024);
+  const std::size_t frames_offset = buffer.size();
+  uint32_t seed = 1;
+  for (std::size_t i = 0; i < 2000; i++) {
+    AppendFLACFrame(buffer, static_cast<uint8_t>(i % 128), 1000, seed);
+  }
+
+  auto score = ScoreAudioPayload(buffer.data(), buffer.size());
+  EXPECT_EQ(score.type, AudioType::kAudioTypeFLAC);
+  EXPECT_EQ(score.payload_offset, frames_offset);
+  EXPECT_DOUBLE_EQ(score.structure_rate, 1.0);
+  EXPECT_GE(score.score, 0.75);
+}
+
+TEST(AudioPayloadScore, CostDoesNotGrowWithFileSize) {
+  // Wrong key: resyncing to the next page must not scan to the end of the file.
+  const auto small = MakeOggWithRandomBody(4 * 1024 * 1024);
+  const auto large = MakeOggWithRandomBody(32 * 1024 * 1024);
+
+  const auto small_score = ScoreAudioPayload(small.data(), small.size());
+  const auto large_score = ScoreAudioPayload(large.data(), large.size());
+  EXPECT_EQ(small_score.bytes_sampled, large_score.bytes_sampled);
+  EXPECT_LT(large_score.score, 0.2);
+}
@@ -0,0 +1,349 @@
+#include "parakeet-audio/verify_audio.h"
+#include "audio_frame_header.h"
+#include "parakeet_crc.h"
+#include "parakeet_endian.h"
+#include "parakeet_simd.h"
+
+#include "parakeet-audio/audio_metadata.h"
+#include "parakeet-audio/detect_audio_type.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace parakeet_audio {
+
+namespace {
+
+constexpr std::array<uint8_t, 4> kOggPageMagic = {'O', 'g', 'g', 'S'};
+
+// Upper bound of a FLAC frame when STREAMINFO does not say (the field is 24-bit).
+constexpr std::size_t kFLACMaxFrameSizeFallback = 0xFF'FFFF;
+
+struct UnitCheck {
+  bool valid;
+  std::size_t end;  // End of the unit when valid.
+};
+
+struct FLACStreamInfo {
+  std::size_t frames_offset;  // 0 if metadata is invalid.
+  std::size_t max_frame_size;
+};
+
+UnitCheck VerifyOggPage(const uint8_t* buffer, std::size_t buffer_len, std::size_t offset) {
+  // The CRC is calculated over the whole page, with the CRC field itself set to zero.
+  constexpr std::size_t kOffsetPageCRC = 22;
+  constexpr std::array<uint8_t, sizeof(uint32_t)> kZeroCRC = {};
+
+  const uint8_t* page = &buffer[offset];
+  const std::size_t page_size = GetOggPageSize(page, buffer_len - offset);
+  if (page_size == 0 || page_size > buffer_len - offset) {
+    return {};
+  }
+
+  constexpr std::size_t kPageBodyOffset = kOffsetPageCRC + sizeof(uint32_t);
+  uint32_t crc = UpdateOggCRC32(0, page, kOffsetPageCRC);
+  crc = UpdateOggCRC32(crc, kZeroCRC.data(), kZeroCRC.size());
+  crc = UpdateOggCRC32(crc, &page[kPageBodyOffset], page_size - kPageBodyOffset);
+  if (crc != ReadLittleEndian<uint32_t>(&page[kOffsetPageCRC])) {
+    return {};
+  }
+  return {true, offset + page_size};
+}
+
+FLACStreamInfo ParseFLACMetadata(const uint8_t* buffer, std::size_t buffer_len, std::size_t offset) {
+  // "fLaC", then STREAMINFO as the first metadata block: uint1_t(is_last) uint7_t(type) uint24_t(len)
+  //   uint16_t(min_block) uint16_t(max_block) uint24_t(min_frame) uint24_t(max_frame) ...
+  constexpr std::size_t kOffsetStreamInfoHeader = 4;
+  constexpr std::size_t kOffsetStreamInfo = 8;
+  constexpr std::size_t kStreamInfoMinSize = 10;
+  constexpr std::size_t kOffsetMaxFrameSize = 6;
+  constexpr uint32_t kUInt24Shift = 8;  // uint24_t read as the top of a uint32_t
+  constexpr uint32_t kBlockLengthMask = 0x00FF'FFFF;
+
+  const std::size_t metadata_size = GetFLACMetadataSize(&buffer[offset], buffer_len - offset);
+  if (metadata_size == 0) {
+    return {};
+  }
+
+  // A complete metadata walk covers STREAMINFO.
+  const uint8_t* flac = &buffer[offset];
+  std::size_t max_frame_size = 0;
+  if ((ReadBigEndian<uint32_t>(&flac[kOffsetStreamInfoHeader]) & kBlockLengthMask) >= kStreamInfoMinSize) {
+    max_frame_size = ReadBigEndian<uint32_t>(&flac[kOffsetStreamInfo + kOffsetMaxFrameSize]) >> kUInt24Shift;
+  }
+  return {offset + metadata_size, max_frame_size != 0 ? max_frame_size : kFLACMaxFrameSizeFallback};
+}
+
+/**
+ * @brief Find the next "OggS" starting in `[pos, end)`.
+ * @return std::size_t `end` if not found.
+ */
+std::size_t FindOggPageMagic(const uint8_t* buffer, std::size_t buffer_len, std::size_t pos, std::size_t end) {
+#if PARAKEET_AUDIO_HAS_SSE2
+  // Compare 16 bytes against 'O', and the same 16 bytes shifted by one to three against "ggS".
+  constexpr std::size_t kBlockSize = 16;
+  constexpr std::size_t kLoadSize = kBlockSize + kOggPageMagic.size() - 1;
+  const __m128i magic_o = _mm_set1_epi8('O');
+  const __m128i magic_g = _mm_set1_epi8('g');
+  const __m128i magic_s = _mm_set1_epi8('S');
+  for (; pos + kBlockSize <= end && pos + kLoadSize <= buffer_len; pos += kBlockSize) {
+    // NOLINTBEGIN(*-type-reinterpret-cast)
+    const __m128i byte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos]));
+    const __m128i byte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos + 1]));
+    const __m128i byte2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos + 2]));
+    const __m128i byte3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos + 3]));
+    // NOLINTEND(*-type-reinterpret-cast)
+    const __m128i magic = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(byte0, magic_o), _mm_cmpeq_epi8(byte1, magic_g)),
+                                        _mm_and_si128(_mm_cmpeq_epi8(byte2, magic_g), _mm_cmpeq_epi8(byte3, magic_s)));
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(magic)); mask != 0) {
+      return pos + detail::CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  for (; pos < end && pos + kOggPageMagic.size() <= buffer_len; pos++) {
+    if (std::equal(kOggPageMagic.begin(), kOggPageMagic.end(), &buffer[pos])) {
+      return pos;
+    }
+  }
+  return end;
+}
+
+/**
+ * @brief Find the next FLAC sync code (`FF F8` or `FF F9`) starting in `[pos, end)`.
+ * @return std::size_t `end` if not found.
+ */
+std::size_t FindFLACSyncCode(const uint8_t* buffer, std::size_t buffer_len, std::size_t pos, std::size_t end) {
+#if PARAKEET_AUDIO_HAS_SSE2
+  // Compare 16 bytes against the first sync byte and the same 16 bytes shifted by one against the second.
+  constexpr std::size_t kBlockSize = 16;
+  const __m128i sync_byte0 = _mm_set1_epi8(static_cast<char>(kFrameSyncByte0));
+  const __m128i sync_mask1 = _mm_set1_epi8(static_cast<char>(kFLACSyncMask1));
+  const __m128i sync1 = _mm_set1_epi8(static_cast<char>(kFLACSync1));
+  for (; pos + kBlockSize < std::min(end + 1, buffer_len); pos += kBlockSize) {
+    // NOLINTBEGIN(*-type-reinterpret-cast)
+    const __m128i lead = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos]));
+    const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[pos + 1]));
+    // NOLINTEND(*-type-reinterpret-cast)
+    const __m128i sync = _mm_and_si128(_mm_cmpeq_epi8(lead, sync_byte0),
+                                       _mm_cmpeq_epi8(_mm_and_si128(next, sync_mask1), sync1));
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(sync)); mask != 0) {
+      return pos + detail::CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  for (; pos < end && pos + 1 < buffer_len; pos++) {
+    if (buffer[pos] == kFrameSyncByte0 && (buffer[pos + 1] & kFLACSyncMask1) == kFLACSync1) {
+      return pos;
+    }
+  }
+  return end;
+}
+
+/**
+ * @brief Find the next FLAC frame header (sync code with a matching CRC-8) in `[pos, end)`.
+ * @return std::size_t `end` if not found.
+ */
+std::size_t FindFLACFrame(const uint8_t* buffer, std::size_t buffer_len, std::size_t pos, std::size_t end) {
+  while (pos < end) {
+    pos = FindFLACSyncCode(buffer, buffer_len, pos, end);
+    if (pos < end && GetFLACFrameHeaderSize(&buffer[pos], buffer_len - pos) != 0) {
+      return pos;
+    }
+    pos++;
+  }
+  return end;
+}
+
+/**
+ * FLAC frames carry no length: try each following frame header (or end of buffer) as the end of this
+ * frame until the CRC-16 footer matches. The CRC is carried forward so the frame is only read once.
+ */
+UnitCheck VerifyFLACFrame(const uint8_t* buffer,
+                          std::size_t buffer_len,
+                          std::size_t offset,
+                          std::size_t max_frame_size) {
+  constexpr std::size_t kFooterSize = sizeof(uint16_t);
+
+  const std::size_t header_size = GetFLACFrameHeaderSize(&buffer[offset], buffer_len - offset);
+  if (header_size == 0) {
+    return {};
+  }
+
+  const std::size_t search_end = std::min(buffer_len, offset + max_frame_size + 1);
+  std::size_t search_pos = offset + header_size;
+  std::size_t crc_pos = offset;
+  uint16_t crc = 0;
+  while (true) {
+    const std::size_t next = FindFLACFrame(buffer, buffer_len, search_pos, search_end);
+    if (next == search_end && search_end != buffer_len) {
+      return {};
+    }
+
+    if (next - offset >= header_size + kFooterSize) {
+      crc = UpdateFLACCRC16(crc, &buffer[crc_pos], next - kFooterSize - crc_pos);
+      crc_pos = next - kFooterSize;
+      if (crc == ReadBigEndian<uint16_t>(&buffer[crc_pos])) {
+        return {true, next};
+      }
+    }
+
+    if (next == search_end) {
+      return {};
+    }
+    search_pos = next + 1;
+  }
+}
+
+/**
+ * @brief Offset of the first checked unit, and how to check units from there on.
+ */
+struct UnitWalker {
+  AudioType type;
+  std::size_t first_unit;
+  std::size_t stream_end;  // Before any trailing ID3v1/APEv2 tag.
+  std::size_t flac_max_frame_size;
+
+  [[nodiscard]] UnitCheck Verify(const uint8_t* buffer, std::size_t buffer_len, std::size_t offset) const {
+    if (type == AudioType::kAudioTypeOGG) {
+      return VerifyOggPage(buffer, buffer_len, offset);
+    }
+    return VerifyFLACFrame(buffer, buffer_len, offset, flac_max_frame_size);
+  }
+
+  /**
+   * @brief Find the next unit starting in `[offset, end)`.
+   * @return std::size_t `end` if not found.
+   */
+  [[nodiscard]] std::size_t Resync(const uint8_t* buffer,
+                                   std::size_t buffer_len,
+                                   std::size_t offset,
+                                   std::size_t end) const {
+    if (type == AudioType::kAudioTypeOGG) {
+      return FindOggPageMagic(buffer, buffer_len, offset, end);
+    }
+    return FindFLACFrame(buffer, buffer_len, offset, end);
+  }
+};
+
+/**
+ * @return AudioIntegrityReport with `first_error_offset` already set if the stream header is broken.
+ */
+AudioIntegrityReport PrepareWalker(const uint8_t* buffer, std::size_t buffer_len, UnitWalker& walker) {
+  AudioIntegrityReport report{DetectAudioType(buffer, buffer_len), 0, 0, buffer_len, 0};
+  walker.type = report.type;
+  walker.first_unit = std::min(GetAudioHeaderMetadataSize(buffer, buffer_len), buffer_len);
+  walker.stream_end =
+      buffer_len - std::min(GetAudioTrailingMetadataSize(buffer, buffer_len), buffer_len - walker.first_unit);
+  walker.flac_max_frame_size = 0;
+
+  if (report.type == AudioType::kAudioTypeFLAC) {
+    const auto stream_info = ParseFLACMetadata(buffer, walker.stream_end, walker.first_unit);
+    if (stream_info.frames_offset == 0) {
+      report.first_error_offset = walker.first_unit;
+    }
+    walker.first_unit = stream_info.frames_offset;
+    walker.flac_max_frame_size = stream_info.max_frame_size;
+  } else if (report.type != AudioType::kAudioTypeOGG) {
+    // Nothing we can verify.
+    walker.type = AudioType::kUnknownType;
+  }
+  return report;
+}
+
+}  // namespace
+
+AudioIntegrityReport VerifyAudioIntegrity(const uint8_t* buffer, std::size_t buffer_len) {
+  UnitWalker walker{};
+  auto report = PrepareWalker(buffer, buffer_len, walker);
+  if (walker.type == AudioType::kUnknownType || report.first_error_offset != buffer_len) {
+    return report;
+  }
+
+  std::size_t pos = walker.first_unit;
+  while (pos < walker.stream_end) {
+    report.units_checked++;
+    const auto unit = walker.Verify(buffer, walker.stream_end, pos);
+    if (!unit.valid) {
+      report.first_error_offset = pos;
+      break;
+    }
+    report.units_valid++;
+    report.checked_end = unit.end;
+    pos = unit.end;
+  }
+  return report;
+}
+
+AudioIntegrityReport SampleAudioIntegrity(const uint8_t* buffer, std::size_t buffer_len, std::size_t sample_count) {
+  UnitWalker walker{};
+  auto report = PrepareWalker(buffer, buffer_len, walker);
+  if (walker.type == AudioType::kUnknownType || report.first_error_offset != buffer_len) {
+    return report;
+  }
+
+  const std::size_t span = walker.stream_end - walker.first_unit;
+  std::size_t next_unchecked = walker.first_unit;
+  for (std::size_t i = 0; i < sample_count; i++) {
+    const std::size_t sample_pos =
+        walker.first_unit + static_cast<std::size_t>(static_cast<uint64_t>(span) * i / sample_count);
+    const std::size_t unit_pos =
+        walker.Resync(buffer, walker.stream_end, std::max(sample_pos, next_unchecked), walker.stream_end);
+    if (unit_pos >= walker.stream_end) {
+      break;
+    }
+
+    report.units_checked++;
+    const auto unit = walker.Verify(buffer, walker.stream_end, unit_pos);
+    if (unit.valid) {
+      report.units_valid++;
+      report.checked_end = std::max(report.checked_end, unit.end);
+      next_unchecked = unit.end;
+    } else {
+      report.first_error_offset = std::min(report.first_error_offset, unit_pos);
+      next_unchecked = unit_pos + 1;
+    }
+  }
+  return report;
+}
+
+AudioIntegrityReport VerifyAudioIntegrityBlock(const uint8_t* buffer,
+                                               std::size_t buffer_len,
+                                               std::size_t block_start,
+                                               std::size_t block_end) {
+  UnitWalker walker{};
+  auto report = PrepareWalker(buffer, buffer_len, walker);
+  if (walker.type == AudioType::kUnknownType || report.first_error_offset != buffer_len) {
+    return report;
+  }
+
+  // Units are looked for in the block, and read no further than `unit_limit`. When none starts in the
+  // block (it lies inside a long page or frame), the first one after it is checked instead.
+  block_end = std::min(block_end, walker.stream_end);
+  const std::size_t unit_limit = block_end + std::min(kAudioIntegrityBlockOverrun, walker.stream_end - block_end);
+  std::size_t pos = std::max(block_start, walker.first_unit);
+  while (true) {
+    const std::size_t search_end = report.units_checked == 0 ? unit_limit : block_end;
+    pos = pos < search_end ? walker.Resync(buffer, unit_limit, pos, search_end) : search_end;
+    if (pos >= search_end) {
+      break;
+    }
+
+    report.units_checked++;
+    const auto unit = walker.Verify(buffer, unit_limit, pos);
+    if (unit.valid) {
+      report.units_valid++;
+      report.checked_end = unit.end;
+      pos = unit.end;
+    } else {
+      report.first_error_offset = std::min(report.first_error_offset, pos);
+      pos++;
+    }
+  }
+  return report;
+}
+
+}  // namespace parakeet_audio
@@ -0,0 +1,174 @@
+#include "parakeet-audio/verify_audio.h"
+
+#include "audio_test_data.test.hh"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using parakeet_audio::AudioType;
+using parakeet_audio::GetValidUnitPercentage;
+using parakeet_audio::SampleAudioIntegrity;
+using parakeet_audio::VerifyAudioIntegrity;
+using parakeet_audio::VerifyAudioIntegrityBlock;
+using parakeet_audio::test::AppendAPEv2;
+using parakeet_audio::test::AppendFLACFrame;
+using parakeet_audio::test::AppendID3v1;
+using parakeet_audio::test::MakeFLACStreamHeader;
+using parakeet_audio::test::NextNoise;
+using parakeet_audio::test::WriteOggPage;
+
+namespace {
+
+// Ogg page with a single segment of `data_len` (<255) noise bytes, and a valid CRC.
+std::size_t AppendOggPage(std::vector<uint8_t>& buffer, uint8_t data_len, uint32_t& seed) {
+  const std::size_t offset = buffer.size();
+  buffer.resize(offset + 28 + data_len);
+  std::generate_n(&buffer[offset + 28], data_len, [&]() { return NextNoise(seed); });
+  WriteOggPage(&buffer[offset], 1, data_len);
+  return offset;
+}
+
+}  // namespace
+
+TEST(AudioIntegrity, OggValid) {
+  uint32_t seed = 1;
+  std::vector<uint8_t> buffer;
+  for (int i = 0; i < 5; i++) {
+    AppendOggPage(buffer, 200, seed);
+  }
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.type, AudioType::kAudioTypeOGG);
+  EXPECT_EQ(report.units_checked, 5);
+  EXPECT_EQ(report.units_valid, 5);
+  EXPECT_EQ(report.first_error_offset, buffer.size());
+}
+
+TEST(AudioIntegrity, OggCorruptedBody) {
+  uint32_t seed = 2;
+  std::vector<uint8_t> buffer;
+  std::vector<std::size_t> pages;
+  for (int i = 0; i < 5; i++) {
+    pages.push_back(AppendOggPage(buffer, 200, seed));
+  }
+  buffer[pages[2] + 100] ^= 0x01;
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.units_checked, 3);
+  EXPECT_EQ(report.units_valid, 2);
+  EXPECT_EQ(report.first_error_offset, pages[2]);
+
+  auto sampled = SampleAudioIntegrity(buffer.data(), buffer.size(), 5);
+  EXPECT_EQ(sampled.units_checked, 5);
+  EXPECT_EQ(sampled.units_valid, 4);
+  EXPECT_EQ(sampled.first_error_offset, pages[2]);
+  EXPECT_DOUBLE_EQ(GetValidUnitPercentage(sampled), 80.0);
+}
+
+TEST(AudioIntegrity, FLACValid) {
+  uint32_t seed = 3;
+  auto buffer = MakeFLACStreamHeader();
+  for (uint8_t i = 0; i < 4; i++) {
+    AppendFLACFrame(buffer, i, 1000, seed);
+  }
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.type, AudioType::kAudioTypeFLAC);
+  EXPECT_EQ(report.units_checked, 4);
+  EXPECT_EQ(report.units_valid, 4);
+  EXPECT_EQ(report.first_error_offset, buffer.size());
+}
+
+TEST(AudioIntegrity, FLACCorruptedFrame) {
+  uint32_t seed = 4;
+  auto buffer = MakeFLACStreamHeader();
+  std::vector<std::size_t> frames;
+  for (uint8_t i = 0; i < 4; i++) {
+    frames.push_back(AppendFLACFrame(buffer, i, 1000, seed));
+  }
+  buffer[frames[1] + 500] ^= 0x80;
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.units_checked, 2);
+  EXPECT_EQ(report.units_valid, 1);
+  EXPECT_EQ(report.first_error_offset, frames[1]);
+
+  auto sampled = SampleAudioIntegrity(buffer.data(), buffer.size(), 4);
+  EXPECT_EQ(sampled.units_checked, 4);
+  EXPECT_EQ(sampled.units_valid, 3);
+  EXPECT_EQ(sampled.first_error_offset, frames[1]);
+}
+
+TEST(AudioIntegrity, FLACWithTrailingTag) {
+  uint32_t seed = 5;
+  auto buffer = MakeFLACStreamHeader();
+  for (uint8_t i = 0; i < 4; i++) {
+    AppendFLACFrame(buffer, i, 1000, seed);
+  }
+  AppendID3v1(buffer);
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.units_checked, 4);
+  EXPECT_EQ(report.units_valid, 4);
+  EXPECT_EQ(report.first_error_offset, buffer.size());
+
+  auto sampled = SampleAudioIntegrity(buffer.data(), buffer.size(), 4);
+  EXPECT_EQ(sampled.units_valid, sampled.units_checked);
+}
+
+TEST(AudioIntegrity, OggWithTrailingTags) {
+  uint32_t seed = 6;
+  std::vector<uint8_t> buffer;
+  for (int i = 0; i < 5; i++) {
+    AppendOggPage(buffer, 200, seed);
+  }
+  AppendAPEv2(buffer, 100);
+  AppendID3v1(buffer);
+
+  auto report = VerifyAudioIntegrity(buffer.data(), buffer.size());
+  EXPECT_EQ(report.units_checked, 5);
+  EXPECT_EQ(report.units_valid, 5);
+  EXPECT_EQ(report.first_error_offset, buffer.size());
+
+  auto sampled = SampleAudioIntegrity(buffer.data(), buffer.size(), 5);
+  EXPECT_EQ(sampled.units_checked, 5);
+  EXPECT_EQ(sampled.units_valid, 5);
+}
+
+TEST(AudioIntegrity, OggBlock) {
+  uint32_t seed = 7;
+  std::vector<uint8_t> buffer;
+  std::vector<std::size_t> pages;
+  for (int i = 0; i < 10; i++) {
+    pages.push_back(AppendOggPage(buffer, 200, seed));
+  }
+  buffer[pages[6] + 100] ^= 0x01;
+
+  // Pages 3 and 4 start in the block, page 4 ends past it.
+  auto report = VerifyAudioIntegrityBlock(buffer.data(), buffer.size(), pages[3] - 10, pages[4] + 10);
+  EXPECT_EQ(report.units_checked, 2);
+  EXPECT_EQ(report.units_valid, 2);
+  EXPECT_EQ(report.checked_end, pages[5]);
+
+  // No page starts in the block: the next one is checked.
+  report = VerifyAudioIntegrityBlock(buffer.data(), buffer.size(), pages[5] + 10, pages[5] + 20);
+  EXPECT_EQ(report.units_checked, 1);
+  EXPECT_EQ(report.units_valid, 0);
+  EXPECT_EQ(report.first_error_offset, pages[6]);
+}
+
+TEST(AudioIntegrity, UnsupportedType) {
+  std::array<uint8_t, 0x20> header = {0xFF, 0xFB, 0x90, 0x64};
+
+  auto report = VerifyAudioIntegrity(header.data(), header.size());
+  EXPECT_EQ(report.type, AudioType::kAudioTypeMP3);
+  EXPECT_EQ(report.units_checked, 0);
+  EXPECT_EQ(report.first_error_offset, header.size());
+}